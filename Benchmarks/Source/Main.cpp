@@ -40,6 +40,15 @@ struct Velocity7 { float x, y, z; };
 struct Position8 { float x, y, z; };
 struct Velocity8 { float x, y, z; };
 
+// Same data as Position/Velocity, stored field split
+struct PositionSoA { float x, y, z; };
+struct VelocitySoA { float x, y, z; };
+
+namespace ECS{
+template<> struct SoALayout<PositionSoA>{ using Field = float; static constexpr size_t Fields = 3; };
+template<> struct SoALayout<VelocitySoA>{ using Field = float; static constexpr size_t Fields = 3; };
+}
+
 constexpr uint32_t N = 1'000'000;
 
 const char* updateSystemLabel = "Update Systems";
@@ -99,6 +108,81 @@ void BenchmarkECS(){
     std::printf("[ECS] %s: %.3f ms\n", updateSystemLabel, ms);
 }
 
+// Speed damped integration, mixes the fields of one component so AoS needs shuffles
+void IntegrateSoA(
+    size_t count,
+    float* __restrict px, float* __restrict py, float* __restrict pz,
+    const float* __restrict vx, const float* __restrict vy, const float* __restrict vz
+){
+    for(size_t i = 0; i < count; ++i){
+        float d = 1.f / (1.f + vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+        px[i] += vx[i] * d;
+        py[i] += vy[i] * d;
+        pz[i] += vz[i] * d;
+    }
+}
+
+void BenchmarkECS_SoA(){
+    World world;
+
+    world.CreateEntities(N, PositionSoA{1,2,3}, VelocitySoA{4,5,6});
+    world.CreateEntities(N, Position{1,2,3}, Velocity{4,5,6});
+
+    Timer t;
+    world.GetView<Position, Velocity>().Each([&](Position& p, const Velocity& v){
+        float d = 1.f / (1.f + v.x * v.x + v.y * v.y + v.z * v.z);
+        p.x += v.x * d;
+        p.y += v.y * d;
+        p.z += v.z * d;
+    });
+    double aosMs = t.elapsed_ms();
+
+    t = Timer();
+    world.GetView<PositionSoA, VelocitySoA>().EachBlock([&](size_t count, SoAColumn<PositionSoA> p, SoAColumn<VelocitySoA> v){
+        IntegrateSoA(count, p[0], p[1], p[2], v[0], v[1], v[2]);
+    });
+    double soaMs = t.elapsed_ms();
+
+    std::printf("[ECS] [SoA] %s: AoS = %.3f ms, SoA = %.3f ms\n", updateSystemLabel, aosMs, soaMs);
+}
+
+void BenchmarkECS_Chunked(){
+    World world(StorageLayout::Chunked);
+
+    for(uint32_t i = 0; i < N; ++i) {
+        Entity e = world.CreateEntity();
+        world.AddComponent(e, Position{1,2,3});
+        world.AddComponent(e, Velocity{4,5,6});
+        world.AddComponent(e, Position2{4,5,6});
+        world.AddComponent(e, Velocity2{4,5,6});
+        world.AddComponent(e, Position3{4,5,6});
+        world.AddComponent(e, Velocity3{4,5,6});
+        world.AddComponent(e, Position4{4,5,6});
+        world.AddComponent(e, Velocity4{4,5,6});
+    }
+
+    Timer t;
+    
+    auto view = world.GetView<Position, Velocity, Position2, Velocity2, Position3, Velocity3, Position4, Velocity4>();
+    view.Each([&](auto& p, const auto& v, auto& p2, const auto& v2, auto& p3, const auto& v3, auto& p4, const auto& v4){
+        p.x += v.x;
+        p.y += v.y;
+        p.z += v.z;
+        p2.x += v2.x;
+        p2.y += v2.y;
+        p2.z += v2.z;
+        p3.x += v3.x;
+        p3.y += v3.y;
+        p3.z += v3.z;
+        p4.x += v4.x;
+        p4.y += v4.y;
+        p4.z += v4.z;
+    });
+
+    double ms = t.elapsed_ms();
+    std::printf("[ECS] [Chunked] %s: %.3f ms\n", updateSystemLabel, ms);
+}
+
 void BenchmarkECS_Thread(){
     World world;
 
@@ -269,6 +353,26 @@ void BenchmarkECS_CreateEntityWithComponets_Batched(){
     std::printf("[ECS] [Batched] %s: %.3f ms\n", createEntityWithComponentLabel, ms);
 }
 
+void BenchmarkECS_CreateEntityWithComponets_Bulk(){
+    World world;
+
+    Timer t;
+    world.CreateEntities(
+        N,
+        Position{1,2,3}, 
+        Velocity{4,5,6},
+        Position2{1,2,3}, 
+        Velocity2{4,5,6},
+        Position3{1,2,3}, 
+        Velocity3{4,5,6},
+        Position4{1,2,3}, 
+        Velocity4{4,5,6}
+    );
+
+    double ms = t.elapsed_ms();
+    std::printf("[ECS] [Bulk] %s: %.3f ms\n", createEntityWithComponentLabel, ms);
+}
+
 void BenchmarkECS_DestroyEntityWithComponets(){
     World world;
 
@@ -299,6 +403,36 @@ void BenchmarkECS_DestroyEntityWithComponets(){
     std::printf("[ECS] %s: %.3f ms\n", destroyEntityWithComponentLabel, ms);
 }
 
+void BenchmarkECS_DestroyEntityWithComponets_Bulk(){
+    World world;
+
+    std::vector<Entity> entities = world.CreateEntities(
+        N,
+        Position{1,2,3}, 
+        Velocity{4,5,6},
+        Position2{1,2,3}, 
+        Velocity2{4,5,6},
+        Position3{1,2,3}, 
+        Velocity3{4,5,6},
+        Position4{1,2,3}, 
+        Velocity4{4,5,6}
+    );
+
+    // Every other entity, so the archetype has to be compacted instead of truncated
+    std::vector<Entity> doomed;
+    for(uint32_t i = 0; i < N; i += 2) doomed.push_back(entities[i]);
+
+    Timer t;
+    world.DestroyEntities(doomed);
+    double ms = t.elapsed_ms();
+
+    Timer t2;
+    world.DestroyMatching(world.GetView<Position>());
+    double ms2 = t2.elapsed_ms();
+
+    std::printf("[ECS] [Bulk] %s: half = %.3f ms, rest by query = %.3f ms\n", destroyEntityWithComponentLabel, ms, ms2);
+}
+
 void BenchmarkECS_ArchetypeExplosion(){
     World world;
 
@@ -341,9 +475,10 @@ void BenchmarkECS_ArchetypeExplosion_Batch(){
 
     Timer t;
 
+    // AddBatch clears the batch, so one batch is reused for every entity
+    ComponentBatch batch;
     for(uint32_t i = 0; i < N; ++i){
         Entity e = world.CreateEntity();
-        ComponentBatch batch;
 
         if(i & (1 <<  0)) batch.Add(Position{1,2,3});
         if(i & (1 <<  1)) batch.Add(Velocity{4,5,6});
@@ -918,6 +1053,77 @@ void BenchmarkECS_MultUpdateSystems_Thread(){
     );
 }
 
+// Word-at-a-time Contains the SIMD kernels replaced, kept as the reference
+bool ContainsScalar(const Signature& a, const Signature& b){
+    for(size_t i = 0; i < NumChunks; ++i){
+        if((a.bits[i] & b.bits[i]) != b.bits[i]) return false;
+    }
+    return true;
+}
+
+void BenchmarkECS_Signature(){
+    constexpr int archetypeCount = 4096;
+    constexpr int rounds = 1000;
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> randomID(0, MaxComponents - 1);
+
+    // Dense case: queries hit components spread across the whole bitset and every archetype matches
+    Signature query;
+    for(int i = 0; i < 16; ++i) query.set(randomID(rng));
+
+    std::vector<Signature> archetypeSigs(archetypeCount, query);
+    for(Signature& sig : archetypeSigs){
+        for(int i = 0; i < 48; ++i) sig.set(randomID(rng));
+    }
+
+    size_t matches = 0;
+    Timer t;
+    for(int r = 0; r < rounds; ++r){
+        for(const Signature& sig : archetypeSigs) matches += ContainsScalar(sig, query);
+    }
+    double scalarMs = t.elapsed_ms();
+
+    t = Timer();
+    for(int r = 0; r < rounds; ++r){
+        for(const Signature& sig : archetypeSigs) matches += sig.Contains(query);
+    }
+    double denseMs = t.elapsed_ms();
+
+    // Sparse case: the usual few low component ids
+    Signature sparseQuery;
+    sparseQuery.set(1);
+    sparseQuery.set(2);
+
+    std::vector<Signature> sparseSigs(archetypeCount, sparseQuery);
+    for(int i = 0; i < archetypeCount; ++i){
+        sparseSigs[i].set(3 + i % 60);
+    }
+
+    t = Timer();
+    for(int r = 0; r < rounds; ++r){
+        for(const Signature& sig : sparseSigs) matches += ContainsScalar(sig, sparseQuery);
+    }
+    double sparseScalarMs = t.elapsed_ms();
+
+    t = Timer();
+    for(int r = 0; r < rounds; ++r){
+        for(const Signature& sig : sparseSigs) matches += sig.Contains(sparseQuery);
+    }
+    double sparseMs = t.elapsed_ms();
+
+    std::printf(
+        "[ECS] [Signature] %d x %d Contains, dense: scalar = %.3f ms, signature = %.3f ms, sparse: scalar = %.3f ms, signature = %.3f ms (%zu)\n",
+        archetypeCount,
+        rounds,
+        scalarMs,
+        denseMs,
+        sparseScalarMs,
+        sparseMs,
+        matches
+    );
+}
+
 /////////////////////////////////
 
 void BenchmarkEnTT(){
@@ -2185,6 +2391,9 @@ int main(){
     RegisterComponent<Position8>();
     RegisterComponent<Velocity8>();
 
+    RegisterComponent<PositionSoA>();
+    RegisterComponent<VelocitySoA>();
+
     //All test are using equivalent entt and flecs function comparated to my library
     //The goal is test the speed of the individual entt and flecs functions and my equivalent functions
     // So:
@@ -2205,6 +2414,8 @@ int main(){
 
     std::printf("\n");
     BenchmarkECS();
+    BenchmarkECS_Chunked();
+    BenchmarkECS_SoA();
     BenchmarkEnTT();
     BenchmarkEnTT_WithGroup();
     BenchmarkFlecs();
@@ -2224,11 +2435,13 @@ int main(){
 
     BenchmarkECS_CreateEntityWithComponets();
     BenchmarkECS_CreateEntityWithComponets_Batched();
+    BenchmarkECS_CreateEntityWithComponets_Bulk();
     BenchmarkEnTT_CreateEntityWithComponets();
     BenchmarkFlecs_CreateEntityWithComponents();
     std::printf("\n");
 
     BenchmarkECS_DestroyEntityWithComponets();
+    BenchmarkECS_DestroyEntityWithComponets_Bulk();
     BenchmarkEnTT_DestroyEntityWithComponets();
     BenchmarkFlecs_DestroyEntityWithComponents();
     std::printf("\n");
@@ -2250,5 +2463,8 @@ int main(){
     //BenchmarkFlecs_MultUpdateSystems_Thread();
     std::printf("\n");
 
+    BenchmarkECS_Signature();
+    std::printf("\n");
+
     return 0;
 }
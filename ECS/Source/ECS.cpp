@@ -1,9 +1,9 @@
 #include "Ecs.h"
 
 #ifndef HeadOnly
-std::vector<ECS::ComponentFactory>& ComponentFactories(){
-    static std::vector<ECS::ComponentFactory> f;
-    return f;
+std::array<ECS::ComponentInfo, ECS::MaxComponents>& ComponentInfos(){
+    static std::array<ECS::ComponentInfo, ECS::MaxComponents> infos;
+    return infos;
 }
 #endif
 
@@ -1,10 +1,28 @@
 #pragma once
 #include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(__AVX2__)
+    #define ECS_SIGNATURE_AVX2
+    #include <immintrin.h>
+#elif defined(__SSE4_1__)
+    #define ECS_SIGNATURE_SSE4
+    #include <smmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define ECS_SIGNATURE_SSE2
+    #include <emmintrin.h>
+#endif
+#include <cstring>
+#include <new>
+#include <type_traits>
 #include <bitset>
 #include <vector>
 #include <set>
 #include <array>
 #include <memory>
+#include <memory_resource>
+#include <unordered_map>
 #include <functional>
 #include <cassert>
 #include <algorithm>
@@ -33,14 +51,44 @@ constexpr uint16_t Invalid = 0xFFFF;
     using ComponentID = uint32_t;
     constexpr Entity InvalidComponentID = 0xFFFFFFFFu;
     constexpr uint16_t MaxComponents = 2500*1;
+    #ifndef ECS_ENTITY_INDEX_BITS
+    #define ECS_ENTITY_INDEX_BITS 24
+    #endif
 #else
     using Entity = uint16_t;
     constexpr Entity InvalidEntity = 0xFFFF;
     using ComponentID = uint16_t;
     constexpr Entity InvalidComponentID = 0xFFFF;
     constexpr uint16_t MaxComponents = 2500*1;
+    #ifndef ECS_ENTITY_INDEX_BITS
+    #define ECS_ENTITY_INDEX_BITS 12
+    #endif
 #endif
 
+// An Entity is [generation | index]. The index addresses World::locations, the generation is
+// bumped every time the index is freed so stale handles stop matching. An index is retired once
+// its generation reaches EntityGenerationMask instead of wrapping back to a value old handles hold.
+using EntityGeneration = uint16_t;
+constexpr uint32_t EntityIndexBits = ECS_ENTITY_INDEX_BITS;
+constexpr uint32_t EntityGenerationBits = sizeof(Entity) * 8 - EntityIndexBits;
+constexpr Entity EntityIndexMask = Entity((1ull << EntityIndexBits) - 1);
+constexpr EntityGeneration EntityGenerationMask = EntityGeneration((1ull << EntityGenerationBits) - 1);
+
+static_assert(EntityIndexBits > 0 && EntityIndexBits < sizeof(Entity) * 8, "Entity needs index and generation bits");
+static_assert(EntityGenerationBits <= sizeof(EntityGeneration) * 8, "Generation does not fit in EntityGeneration");
+
+constexpr Entity EntityIndex(Entity e){
+    return e & EntityIndexMask;
+}
+
+constexpr EntityGeneration GetEntityGeneration(Entity e){
+    return EntityGeneration(e >> EntityIndexBits);
+}
+
+constexpr Entity MakeEntity(Entity index, EntityGeneration generation){
+    return Entity((Entity(generation) << EntityIndexBits) | index);
+}
+
 #ifndef UseDLLSafe
 
 inline ComponentID GetUniqueComponentID(){
@@ -71,29 +119,187 @@ ComponentID GetComponentID(){
 
 ///////////////////////////////
 
+// v must not be zero
+inline uint32_t CountTrailingZeros64(uint64_t v){
+    #if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return (uint32_t)index;
+    #else
+    return (uint32_t)__builtin_ctzll(v);
+    #endif
+}
+
+// v must not be zero
+inline uint32_t CountLeadingZeros64(uint64_t v){
+    #if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return 63 - (uint32_t)index;
+    #else
+    return (uint32_t)__builtin_clzll(v);
+    #endif
+}
+
+inline uint32_t PopCount64(uint64_t v){
+    #if defined(_MSC_VER)
+    return (uint32_t)std::bitset<64>(v).count();
+    #else
+    return (uint32_t)__builtin_popcountll(v);
+    #endif
+}
+
+///////////////////////////////
+
 constexpr size_t ChunkBits = 64;
 constexpr size_t NumChunks = (MaxComponents + 63) / 64;
 
+static_assert(NumChunks <= 64, "Signature::summary holds one bit per chunk");
+
+////////////////////////////////
+// Whole-bitset signature kernels. Picked at compile time: AVX2, SSE4.1, SSE2, then scalar.
+// Signatures only switch to these once DenseChunks chunks are populated; below that the
+// per-chunk loop over the summary bits is cheaper.
+
+#if defined(ECS_SIGNATURE_AVX2)
+constexpr uint32_t DenseChunks = 8;
+static_assert(NumChunks % 4 == 0, "AVX2 kernels load 4 chunks at a time");
+
+// (a & b) == b
+inline bool DenseContains(const uint64_t* a, const uint64_t* b){
+    for(size_t i = 0; i < NumChunks; i += 4){
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        if(!_mm256_testc_si256(va, vb)) return false;
+    }
+    return true;
+}
+
+inline bool DenseIntersects(const uint64_t* a, const uint64_t* b){
+    for(size_t i = 0; i < NumChunks; i += 4){
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        if(!_mm256_testz_si256(va, vb)) return true;
+    }
+    return false;
+}
+
+inline bool DenseEqual(const uint64_t* a, const uint64_t* b){
+    for(size_t i = 0; i < NumChunks; i += 4){
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i diff = _mm256_xor_si256(va, vb);
+        if(!_mm256_testz_si256(diff, diff)) return false;
+    }
+    return true;
+}
+
+#elif defined(ECS_SIGNATURE_SSE4) || defined(ECS_SIGNATURE_SSE2)
+constexpr uint32_t DenseChunks = 12;
+static_assert(NumChunks % 2 == 0, "SSE kernels load 2 chunks at a time");
+
+inline bool IsZero128(__m128i v){
+    #if defined(ECS_SIGNATURE_SSE4)
+    return _mm_testz_si128(v, v);
+    #else
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF;
+    #endif
+}
+
+// (a & b) == b
+inline bool DenseContains(const uint64_t* a, const uint64_t* b){
+    for(size_t i = 0; i < NumChunks; i += 2){
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        if(!IsZero128(_mm_andnot_si128(va, vb))) return false;
+    }
+    return true;
+}
+
+inline bool DenseIntersects(const uint64_t* a, const uint64_t* b){
+    for(size_t i = 0; i < NumChunks; i += 2){
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        if(!IsZero128(_mm_and_si128(va, vb))) return true;
+    }
+    return false;
+}
+
+inline bool DenseEqual(const uint64_t* a, const uint64_t* b){
+    for(size_t i = 0; i < NumChunks; i += 2){
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        if(!IsZero128(_mm_xor_si128(va, vb))) return false;
+    }
+    return true;
+}
+
+#else
+constexpr uint32_t DenseChunks = 12;
+
+// (a & b) == b
+inline bool DenseContains(const uint64_t* a, const uint64_t* b){
+    uint64_t missing = 0;
+    for(size_t i = 0; i < NumChunks; ++i) missing |= b[i] & ~a[i];
+    return missing == 0;
+}
+
+inline bool DenseIntersects(const uint64_t* a, const uint64_t* b){
+    uint64_t common = 0;
+    for(size_t i = 0; i < NumChunks; ++i) common |= a[i] & b[i];
+    return common != 0;
+}
+
+inline bool DenseEqual(const uint64_t* a, const uint64_t* b){
+    uint64_t diff = 0;
+    for(size_t i = 0; i < NumChunks; ++i) diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
+#endif
+
 struct Signature{
+    uint64_t summary = 0; // Bit w is set when bits[w] != 0, so operations only visit populated chunks
     std::array<uint64_t, NumChunks> bits{};
 
     void set(ComponentID id){
         bits[id / 64] |= (1ull << (id & 63));
+        summary |= (1ull << (id / 64));
+    }
+
+    void reset(ComponentID id){
+        bits[id / 64] &= ~(1ull << (id & 63));
+        if(bits[id / 64] == 0) summary &= ~(1ull << (id / 64));
     }
 
     bool test(ComponentID id) const {
         return bits[id / 64] & (1ull << (id & 63));
     }
 
+    // this |= other
+    void Merge(const Signature& other){
+        for(uint64_t m = other.summary; m; m &= m - 1){
+            size_t i = CountTrailingZeros64(m);
+            bits[i] |= other.bits[i];
+        }
+        summary |= other.summary;
+    }
+
     bool operator==(const Signature& other) const {
-        for(size_t i = 0; i < NumChunks; ++i){
+        if(summary != other.summary) return false;
+        if(PopCount64(summary) >= DenseChunks) return DenseEqual(bits.data(), other.bits.data());
+        for(uint64_t m = summary; m; m &= m - 1){
+            size_t i = CountTrailingZeros64(m);
             if(bits[i] != other.bits[i]) return false;
         }
         return true;
     }
 
     bool Contains(const Signature& other) const {
-        for(size_t i = 0; i < NumChunks; ++i){
+        if((summary & other.summary) != other.summary) return false;
+        if(PopCount64(other.summary) >= DenseChunks) return DenseContains(bits.data(), other.bits.data());
+        for(uint64_t m = other.summary; m; m &= m - 1){
+            size_t i = CountTrailingZeros64(m);
             if((bits[i] & other.bits[i]) != other.bits[i]){
                 return false;
             }
@@ -102,7 +308,10 @@ struct Signature{
     }
 
     bool Intersects(const Signature& other) const {
-        for(size_t i = 0; i < NumChunks; ++i){
+        const uint64_t common = summary & other.summary;
+        if(PopCount64(common) >= DenseChunks) return DenseIntersects(bits.data(), other.bits.data());
+        for(uint64_t m = common; m; m &= m - 1){
+            size_t i = CountTrailingZeros64(m);
             if(bits[i] & other.bits[i]){
                 return true;
             }
@@ -126,8 +335,10 @@ struct Signature{
 
     size_t Hash() const {
         size_t h = 1469598103934665603ull; // FNV-1a offset
-        for(size_t i = 0; i < NumChunks; ++i){
-            h ^= bits[i];
+        h ^= summary;
+        h *= 1099511628211ull;
+        for(uint64_t m = summary; m; m &= m - 1){
+            h ^= bits[CountTrailingZeros64(m)];
             h *= 1099511628211ull;
         }
         return h;
@@ -136,54 +347,151 @@ struct Signature{
 
 ///////////////////////////////
 
-struct IComponentArray {
-    virtual ~IComponentArray() = default;
-    virtual size_t Size() = 0;
-    virtual void Remove(size_t index) = 0;
-    virtual void CopyElementTo(IComponentArray* dst, size_t srcIndex) = 0;
-    virtual void EmplaceFromRaw(void* src) = 0;
-    virtual ComponentID GetID() const = 0; 
+// Every column (and SoA field array) starts on a cache line and its tail is padded to the next
+// one, so a kernel may run whole 64 byte vectors past the last row without leaving the column.
+constexpr size_t ColumnAlign = 64;
+
+// Tells the compiler ptr is aligned to N, so vectorized loops need no peeling
+template<size_t N, typename T>
+inline T* AssumeAligned(T* ptr){
+    #if defined(__GNUC__) || defined(__clang__)
+    return static_cast<T*>(__builtin_assume_aligned(ptr, N));
+    #elif defined(_MSC_VER)
+    __assume((reinterpret_cast<uintptr_t>(ptr) & (N - 1)) == 0);
+    return ptr;
+    #else
+    return ptr;
+    #endif
+}
+
+///////////////////////////////
+
+// Opt-in field split (SoA) storage. Specialize for a component made of Fields values of one
+// scalar type, e.g. template<> struct ECS::SoALayout<Position>{ using Field = float; static constexpr size_t Fields = 3; };
+// Each field is then stored as its own aligned array inside the block, read it through
+// View::EachBlock or World::GetComponent (which returns an SoARef).
+template<typename T>
+struct SoALayout{
+    static constexpr size_t Fields = 0;
 };
 
 template<typename T>
-struct ComponentArray : IComponentArray {
-    std::vector<T> data;
+constexpr bool IsSoA = SoALayout<T>::Fields != 0;
 
-    size_t Size() override {
-        return data.size();
-    }
+// Bytes between two field arrays of rows elements. Row counts are powers of two, so without
+// the extra cache line every field would sit a multiple of 4 KiB apart and the streams of a
+// loop over several fields would alias in L1.
+inline size_t SoAFieldPitch(size_t rows, size_t fieldSize){
+    return ((rows * fieldSize + 63) & ~size_t(63)) + 64;
+}
+
+// Per block view of an SoA column: field f of the block is the array (*this)[f]
+template<typename T>
+struct SoAColumn{
+    using Field = typename SoALayout<T>::Field;
+
+    Field* base;
+    size_t stride;     // Elements between two field arrays
+    size_t offset = 0; // First row handed out, View::EachBlock skips disabled runs with it
 
-    void Remove(size_t index) override {
-        data[index] = std::move(data.back());
-        data.pop_back();
+    Field* operator[](size_t f) const {
+        return AssumeAligned<ColumnAlign>(base + f * stride) + offset;
     }
+};
+
+// Reference to one SoA element, gathers and scatters the fields on conversion and assignment
+template<typename T>
+struct SoARef{
+    using Field = typename SoALayout<T>::Field;
+
+    Field* first;
+    size_t stride;
 
-    void CopyElementTo(IComponentArray* dst, size_t srcIndex) override {
-        assert(dst->GetID() == GetComponentID<T>() && "Invalid component cast");
-        auto* d = static_cast<ComponentArray<T>*>(dst);
-        d->data.push_back(data[srcIndex]);
+    Field& operator[](size_t f) const {
+        return first[f * stride];
     }
 
-    void EmplaceFromRaw(void* src) override {
-        data.push_back(std::move(*static_cast<T*>(src)));
+    operator T() const {
+        Field values[SoALayout<T>::Fields];
+        for(size_t f = 0; f < SoALayout<T>::Fields; ++f) values[f] = first[f * stride];
+        T value;
+        std::memcpy(&value, values, sizeof(T));
+        return value;
     }
 
-    ComponentID GetID() const override {
-        return GetComponentID<T>();
+    const SoARef& operator=(const T& value) const {
+        Field values[SoALayout<T>::Fields];
+        std::memcpy(values, &value, sizeof(T));
+        for(size_t f = 0; f < SoALayout<T>::Fields; ++f) first[f * stride] = values[f];
+        return *this;
     }
 };
 
-////////////////////////////////
+// Opt-in sparse set storage for components toggled often, e.g.
+// template<> struct ECS::SparseStorage<Stunned> : std::true_type {};
+// They live in a World::SparseSet outside the archetypes and never enter a signature, so adding
+// or removing one does not move the entity. Views join them per entity.
+template<typename T>
+struct SparseStorage : std::false_type {};
+
+template<typename T>
+constexpr bool IsSparse = SparseStorage<T>::value;
+
+// Type erased description of a component, filled by RegisterComponent<T>
+struct ComponentInfo {
+    ComponentID id = InvalidComponentID;
+    size_t size = 0;
+    size_t align = 0;
+    bool triviallyRelocatable = false; // Copy, move and relocation are a memcpy
+    bool tag = false;                  // Empty type, only a signature bit and never a column
+    uint16_t soaFields = 0;            // Field arrays of an SoA component, 0 when stored AoS
+    uint16_t fieldSize = 0;
+
+    void (*copy)(void* dst, const void* src) = nullptr; // Placement copy construct
+    void (*move)(void* dst, void* src) = nullptr;       // Placement move construct
+    void (*destroy)(void* ptr) = nullptr;
+};
+
+template<typename T>
+ComponentInfo MakeComponentInfo(){
+    ComponentInfo info;
+    info.id = GetComponentID<T>();
+    info.size = sizeof(T);
+    info.align = alignof(T);
+    info.triviallyRelocatable = std::is_trivially_copyable_v<T>;
+    info.tag = std::is_empty_v<T>;
+    static_assert(!(IsSoA<T> && IsSparse<T>), "A component is either SoA or sparse");
+    if constexpr (IsSoA<T>){
+        using Field = typename SoALayout<T>::Field;
+        static_assert(std::is_trivially_copyable_v<T>, "SoA components must be trivially copyable");
+        static_assert(sizeof(T) == SoALayout<T>::Fields * sizeof(Field), "SoA components must be made of Fields values of type Field");
+
+        info.soaFields = (uint16_t)SoALayout<T>::Fields;
+        info.fieldSize = (uint16_t)sizeof(Field);
+    }
+    info.copy = [](void* dst, const void* src){ new(dst) T(*static_cast<const T*>(src)); };
+    info.move = [](void* dst, void* src){ new(dst) T(std::move(*static_cast<T*>(src))); };
+    info.destroy = [](void* ptr){ static_cast<T*>(ptr)->~T(); };
+    return info;
+}
 
-using ComponentFactory = IComponentArray*(*)();
+// A column inside an archetype block, size is copied from the info because row addressing needs it
+struct ComponentColumn {
+    const ComponentInfo* info = nullptr;
+    size_t size = 0;
+    size_t offset = 0;     // Byte offset of this column inside an archetype block
+    size_t fieldPitch = 0; // SoA only, bytes between two field arrays
+};
+
+////////////////////////////////
 
 #ifdef HeadOnly
-inline std::vector<ComponentFactory>& ComponentFactories(){
-    static std::vector<ComponentFactory> f;
-    return f;
+inline std::array<ComponentInfo, MaxComponents>& ComponentInfos(){
+    static std::array<ComponentInfo, MaxComponents> infos;
+    return infos;
 }
 #else
-ECS_API std::vector<ComponentFactory>& ComponentFactories();
+ECS_API std::array<ComponentInfo, MaxComponents>& ComponentInfos();
 #endif
 
 template<typename T>
@@ -193,198 +501,1232 @@ ComponentID RegisterComponent(){
     #endif
 
     ComponentID id = GetComponentID<T>();
-    auto& f = ComponentFactories();
-    if(id >= f.size()){
-        f.resize(id + 1);
-    }
-    f[id] = []() -> IComponentArray* { return new ComponentArray<T>(); };
+    assert(id < MaxComponents && "Too many components");
+    ComponentInfos()[id] = MakeComponentInfo<T>();
     return id;
 }
 
 ////////////////////////////////
 
+// Array split in fixed size pages allocated on demand. Growing never moves or copies the
+// elements already stored, so their addresses are stable and there is no resize spike.
+template<typename T, size_t PageBits = 12>
+struct PagedArray{
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>, "PagedArray holds plain data only");
+
+    static constexpr size_t PageSize = size_t(1) << PageBits;
+    static constexpr size_t PageMask = PageSize - 1;
+
+    std::pmr::vector<T*> pages;
+    size_t count = 0;
+
+    explicit PagedArray(std::pmr::memory_resource* resource = std::pmr::get_default_resource()):pages(resource){}
+
+    PagedArray(const PagedArray&) = delete;
+    PagedArray& operator=(const PagedArray&) = delete;
+
+    ~PagedArray(){
+        for(T* page : pages){
+            Resource()->deallocate(page, PageSize * sizeof(T), alignof(T));
+        }
+    }
+
+    T& operator[](size_t i){
+        return pages[i >> PageBits][i & PageMask];
+    }
+
+    const T& operator[](size_t i) const {
+        return pages[i >> PageBits][i & PageMask];
+    }
+
+    size_t size() const { return count; }
+
+    // New elements are value initialized, shrinking keeps the pages.
+    // Everything past count is kept value initialized, so growing only allocates.
+    void resize(size_t n){
+        while(pages.size() * PageSize < n){
+            T* page = static_cast<T*>(Resource()->allocate(PageSize * sizeof(T), alignof(T)));
+            std::uninitialized_value_construct_n(page, PageSize);
+            pages.push_back(page);
+        }
+
+        for(size_t i = n; i < count; ++i){
+            (*this)[i] = T{};
+        }
+        count = n;
+    }
+
+    std::pmr::memory_resource* Resource() const {
+        return pages.get_allocator().resource();
+    }
+};
+
+////////////////////////////////
+
 struct Archetype;
 
+// Row plus the slot of the archetype in World::archetypeByIndex, 0 means no archetype.
+// Kept at 8 bytes so the location table stays dense in cache.
 struct EntityLocation{
     uint32_t index;
-    Archetype* archetype = nullptr;
+    uint32_t archetype = 0;
 };
 
+static_assert(sizeof(EntityLocation) == 8, "EntityLocation should stay 8 bytes");
+
+using EntityLocations = PagedArray<EntityLocation>;
+
 ////////////////////////////////
 
-struct Archetype{
-    Signature signature;
-    std::array<uint16_t, MaxComponents> mapToComponents;
-    //std::vector<uint16_t> mapToComponents;
-    std::vector<ComponentID> componentIDs;
-    std::vector<IComponentArray*> components; // size = number of components in archetype
-    std::vector<Entity> entities;
+// Entities holding one sparse component. dense and the values of SparseSet<T> are parallel
+// arrays, sparse maps an entity index to its dense slot + 1 (0 is absent).
+struct SparseSetBase{
+    PagedArray<uint32_t> sparse;
+    std::pmr::vector<Entity> dense;
+    size_t objectSize = 0;
+    size_t objectAlign = 0;
+
+    explicit SparseSetBase(std::pmr::memory_resource* resource):sparse(resource),dense(resource){}
+    virtual ~SparseSetBase() = default;
+
+    size_t Size() const { return dense.size(); }
+
+    bool Has(Entity e) const {
+        const Entity index = EntityIndex(e);
+        return index < sparse.size() && sparse[index] != 0 && dense[sparse[index] - 1] == e;
+    }
+
+    // Drops whatever lives at this entity index, called when the index is freed
+    virtual void RemoveIndex(Entity index) = 0;
+};
+
+template<typename T>
+struct SparseSet : SparseSetBase{
+    std::pmr::vector<T> values;
+
+    explicit SparseSet(std::pmr::memory_resource* resource):SparseSetBase(resource),values(resource){}
+
+    T& Get(Entity e){
+        assert(Has(e) && "Entity does not have component");
+        return values[sparse[EntityIndex(e)] - 1];
+    }
+
+    void Emplace(Entity e, T&& value){
+        assert(!Has(e) && "Already Contain Comp!!");
+        const Entity index = EntityIndex(e);
+        if(index >= sparse.size()) sparse.resize(index + 1);
+
+        dense.push_back(e);
+        values.push_back(std::move(value));
+        sparse[index] = (uint32_t)dense.size();
+    }
+
+    // Swap-remove, the last element takes the slot
+    void RemoveIndex(Entity index) override {
+        if(index >= sparse.size() || sparse[index] == 0) return;
+
+        const uint32_t slot = sparse[index] - 1;
+        if(slot != dense.size() - 1){
+            dense[slot] = dense.back();
+            values[slot] = std::move(values.back());
+            sparse[EntityIndex(dense[slot])] = slot + 1;
+        }
+        dense.pop_back();
+        values.pop_back();
+        sparse[index] = 0;
+    }
+};
+
+struct SparseSetDeleter{
+    std::pmr::memory_resource* resource = nullptr;
+
+    void operator()(SparseSetBase* s) const {
+        const size_t size = s->objectSize;
+        const size_t align = s->objectAlign;
+        s->~SparseSetBase();
+        resource->deallocate(s, size, align);
+    }
+};
+
+using SparseSetPtr = std::unique_ptr<SparseSetBase, SparseSetDeleter>;
+
+////////////////////////////////
+
+constexpr size_t BlockBytes = 16 * 1024;
+
+enum class StorageLayout : uint8_t {
+    Contiguous, // One growable block per archetype, every column is a single array
+    Chunked     // Fixed BlockBytes blocks, growth never moves existing rows
+};
 
-    Archetype(const Signature& sig):signature(sig){
-        //mapToComponents.resize(MaxComponents);
-        //std::fill(mapToComponents.begin(), mapToComponents.end(), Invalid);
+inline size_t AlignUp(size_t value, size_t align){
+    return (value + align - 1) & ~(align - 1);
+}
+
+struct ColumnSlot{
+    ComponentID id = InvalidComponentID;
+    uint16_t column = Invalid;
+};
+
+struct Archetype;
+
+// Cached AddComponent/RemoveComponent transition for one component
+struct ArchetypeEdge{
+    ComponentID id = InvalidComponentID;
+    Archetype* add = nullptr;
+    Archetype* remove = nullptr;
+};
+
+// Archetypes only have a handful of edges, a linear scan beats hashing the signature
+inline ArchetypeEdge& FindEdge(std::pmr::vector<ArchetypeEdge>& edges, ComponentID id){
+    for(auto& e : edges){
+        if(e.id == id) return e;
+    }
+    edges.push_back({ id });
+    return edges.back();
+}
 
-        mapToComponents.fill(Invalid);
+struct Archetype{
+    Signature signature;
+    std::pmr::memory_resource* resource; // Blocks and metadata come from here
+
+    // Open addressing table ComponentID -> column, twice the component count so a lookup
+    // is almost always a single probe and memory follows the components actually present
+    std::pmr::vector<ColumnSlot> columnSlots{resource};
+    size_t slotMask = 0;
+    std::pmr::vector<ComponentID> componentIDs{resource}; // Every component, tags included
+    std::pmr::vector<ComponentColumn> columns{resource};  // One per component that is not a tag
+
+    // Each block holds the entity IDs followed by every column for blockRows rows:
+    // [Entity x blockRows][column 0 x blockRows][column 1 x blockRows]...
+    std::pmr::vector<uint8_t*> blocks{resource};
+    StorageLayout layout;
+    size_t count = 0;
+    size_t blockRows = 0;
+    size_t blockMask = 0;
+    uint32_t blockShift = 0;
+    size_t blockAlign = ColumnAlign;
+    size_t blockBytes = 0; // Every block has this size, Contiguous has a single one
+
+    std::pmr::vector<ArchetypeEdge> edges{resource};
+
+    uint32_t denseIndex = 0; // Slot in World::archetypeByIndex
+
+    // Rows switched off without leaving the archetype, one bit per row. Mask 0 is the whole
+    // entity, mask 1 + c only column c. Allocated on the first disable, so archetypes that never
+    // disable anything keep their fast paths.
+    struct RowMask {
+        std::pmr::vector<uint64_t> words;
+        size_t count = 0;
+    };
+    std::pmr::vector<RowMask> disabled{resource};
+    size_t disabledTotal = 0;
+
+    Archetype(
+        const Signature& sig,
+        StorageLayout layout = StorageLayout::Contiguous,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+    ):signature(sig),resource(resource),layout(layout){
+        for(uint64_t m = signature.summary; m; m &= m - 1){
+            const size_t w = CountTrailingZeros64(m);
+            for(uint64_t bits = signature.bits[w]; bits; bits &= bits - 1){
+                ComponentID i = (ComponentID)(w * ChunkBits + CountTrailingZeros64(bits));
+                const ComponentInfo& info = ComponentInfos()[i];
+                assert(info.size != 0 && "Component not registered");
 
-        for(ComponentID i = 0; i < MaxComponents; ++i){
-            if(signature.test(i)){
-                mapToComponents[i] = components.size();
                 componentIDs.push_back(i);
-                components.push_back(ComponentFactories()[i]());
+                if(!info.tag) columns.push_back({ &info, info.size, 0 });
             }
         }
+
+        size_t slots = 2;
+        while(slots < columns.size() * 2) slots <<= 1;
+        columnSlots.resize(slots);
+        slotMask = slots - 1;
+
+        for(size_t c = 0; c < columns.size(); ++c){
+            const ComponentID id = columns[c].info->id;
+            size_t h = id & slotMask;
+            while(columnSlots[h].id != InvalidComponentID) h = (h + 1) & slotMask;
+            columnSlots[h] = { id, (uint16_t)c };
+        }
+
+        size_t rowBytes = sizeof(Entity);
+        size_t padding = ColumnAlign - 1;
+        for(auto& c : columns){
+            rowBytes += c.size;
+            padding += std::max(ColumnAlign, c.info->align) - 1;
+            padding += c.info->soaFields * 128; // SoAFieldPitch rounding and skew
+            blockAlign = std::max(blockAlign, c.info->align);
+        }
+
+        if(layout == StorageLayout::Chunked){
+            // Largest power of two rows that fits, so row -> block is a shift and a mask
+            size_t rows = BlockBytes > padding ? (BlockBytes - padding) / rowBytes : 1;
+            blockShift = 0;
+            while((size_t(2) << blockShift) <= rows) ++blockShift;
+            blockRows = size_t(1) << blockShift;
+            blockBytes = Layout(blockRows, true);
+        } else {
+            // A single block, every valid row maps to block 0
+            blockShift = 31;
+        }
+        blockMask = (size_t(1) << blockShift) - 1;
     }
 
+    Archetype(const Archetype&) = delete;
+    Archetype& operator=(const Archetype&) = delete;
+
     ~Archetype(){
-        for(auto* c : components){
-            delete c;
+        for(size_t b = 0; b < BlockCount(); ++b){
+            for(auto& c : columns){
+                DestroyRange(c, blocks[b] + c.offset, BlockSize(b));
+            }
+        }
+
+        for(uint8_t* b : blocks){
+            FreeBlock(b);
         }
     }
 
     template<typename T>
-    ComponentArray<T>* Get(){
+    ComponentColumn* Get(){
         ComponentID id = GetComponentID<T>();
-        uint16_t index = mapToComponents[id];
+        uint16_t index = ColumnIndex(id);
         assert(index != Invalid && "Component not in archetype");
         
-        assert(components[index]->GetID() == GetComponentID<T>() && "Invalid component cast");
-        return static_cast<ComponentArray<T>*>(components[index]);
+        assert(columns[index].info->id == GetComponentID<T>() && "Invalid component cast");
+        return &columns[index];
     }
 
     template<typename T>
-    ComponentArray<T>* GetFast(){
-        assert(components[mapToComponents[GetComponentID<T>()]]->GetID() == GetComponentID<T>() && "Invalid component cast");
-        return static_cast<ComponentArray<T>*>(components[mapToComponents[GetComponentID<T>()]]);
+    ComponentColumn* GetFast(){
+        assert(columns[ColumnIndex(GetComponentID<T>())].info->id == GetComponentID<T>() && "Invalid component cast");
+        return &columns[ColumnIndex(GetComponentID<T>())];
     }
 
     bool Has(ComponentID id) const {
-        return mapToComponents[id] != Invalid;
+        return signature.test(id);
+    }
+
+    // Returns Invalid when the component is not in this archetype
+    uint16_t ColumnIndex(ComponentID id) const {
+        size_t h = id & slotMask;
+        while(columnSlots[h].id != id){
+            if(columnSlots[h].id == InvalidComponentID) return Invalid;
+            h = (h + 1) & slotMask;
+        }
+        return columnSlots[h].column;
     }
 
     size_t Size(){
-        return components.empty() ? 0 : components[0]->Size();
+        return count;
     }
 
-    void Remove(size_t row){
-        assert(false && "I think this is bug");
-        //Entity moved = entities.back();
+    // Number of blocks holding at least one row
+    size_t BlockCount() const {
+        return count == 0 ? 0 : ((count - 1) >> blockShift) + 1;
+    }
+
+    // Number of rows stored in block b
+    size_t BlockSize(size_t b) const {
+        return std::min(count - (b << blockShift), blockRows);
+    }
+
+    // Block bases and column offsets are ColumnAlign aligned, so are the arrays handed out here
+    Entity* Entities(size_t b){
+        return AssumeAligned<ColumnAlign>(reinterpret_cast<Entity*>(blocks[b]));
+    }
 
-        for(auto& c : components){
-            c->Remove(row);
+    // Tags have no column. An empty type has no state to read or write, so any address inside
+    // the block (here the entity IDs) is a valid stand-in and views can still take T&.
+    template<typename T>
+    T* Column(size_t b){
+        static_assert(!IsSoA<T>, "SoA components have no T array, use ColumnSpan/View::EachBlock");
+        if constexpr (std::is_empty_v<T>){
+            return reinterpret_cast<T*>(blocks[b]);
+        } else {
+            return AssumeAligned<ColumnAlign>(reinterpret_cast<T*>(blocks[b] + GetFast<T>()->offset));
         }
+    }
 
-        //entities[row] = moved;
-        //entities.pop_back();
+    Entity& EntityAt(size_t row){
+        return Entities(row >> blockShift)[row & blockMask];
     }
 
-    void Remove(size_t row, std::vector<EntityLocation>& locations){
-        Entity moved = entities.back();
+    template<typename T>
+    T& At(size_t row){
+        return Column<T>(row >> blockShift)[row & blockMask];
+    }
 
-        for(auto* c : components){
-            c->Remove(row);
+    // Column<T> for regular components, an SoAColumn<T> for SoA ones
+    template<typename T>
+    auto ColumnSpan(size_t b){
+        if constexpr (IsSoA<T>){
+            using Field = typename SoALayout<T>::Field;
+            const ComponentColumn& c = *GetFast<T>();
+            return SoAColumn<T>{ reinterpret_cast<Field*>(blocks[b] + c.offset), c.fieldPitch / sizeof(Field) };
+        } else {
+            return Column<T>(b);
         }
+    }
 
-        entities[row] = moved;
-        entities.pop_back();
+    // At<T> for regular components, an SoARef<T> for SoA ones
+    template<typename T>
+    decltype(auto) Ref(size_t row){
+        if constexpr (IsSoA<T>){
+            using Field = typename SoALayout<T>::Field;
+            const ComponentColumn& c = *GetFast<T>();
+            return SoARef<T>{ reinterpret_cast<Field*>(FieldElement(c, 0, row)), c.fieldPitch / sizeof(Field) };
+        } else {
+            return At<T>(row);
+        }
+    }
 
-        if(moved != InvalidEntity){
-            locations[moved].index = row;
+    uint8_t* Element(const ComponentColumn& c, size_t row){
+        return blocks[row >> blockShift] + c.offset + (row & blockMask) * c.size;
+    }
+
+    // Field f of row in an SoA column
+    uint8_t* FieldElement(const ComponentColumn& c, size_t f, size_t row){
+        return blocks[row >> blockShift] + c.offset + f * c.fieldPitch + (row & blockMask) * c.info->fieldSize;
+    }
+
+    template<typename T, typename... Args>
+    void Construct(size_t row, Args&&... args){
+        if constexpr (IsSoA<T>){
+            Ref<T>(row) = T(std::forward<Args>(args)...);
+        } else if constexpr (!std::is_empty_v<T>){
+            new(&At<T>(row)) T(std::forward<Args>(args)...);
         }
     }
 
-    void CopyRowTo(Archetype& dst, size_t row){
-        for(ComponentID id : componentIDs){
-            uint16_t d = dst.mapToComponents[id];
-            if(d != Invalid){
-                components[mapToComponents[id]]->CopyElementTo(dst.components[d], row);
+    // Constructs n copies of value from row on, the rows must sit in one block
+    template<typename T>
+    void Fill(size_t row, size_t n, const T& value){
+        if constexpr (IsSoA<T>){
+            using Field = typename SoALayout<T>::Field;
+            Field values[SoALayout<T>::Fields];
+            std::memcpy(values, &value, sizeof(T));
+
+            const ComponentColumn& c = *GetFast<T>();
+            for(size_t f = 0; f < SoALayout<T>::Fields; ++f){
+                std::fill_n(reinterpret_cast<Field*>(FieldElement(c, f, row)), n, values[f]);
             }
+        } else if constexpr (!std::is_empty_v<T>){
+            std::uninitialized_fill_n(&At<T>(row), n, value);
         }
     }
-};
 
-////////////////////////////////
+    void Reserve(size_t rows){
+        if(rows <= blocks.size() * blockRows) return;
 
-struct World;
+        if(layout == StorageLayout::Chunked){
+            while(blocks.size() * blockRows < rows){
+                blocks.push_back(AllocateBlock(blockBytes));
+            }
+            return;
+        }
 
-inline uint32_t GetWorkerCount(uint32_t max = UINT32_MAX){
-    uint32_t n = std::thread::hardware_concurrency();
-    return n ? std::min(n, max) : 1;
-}
+        size_t newRows = std::max<size_t>(blockRows * 2, 16);
+        while(newRows < rows) newRows *= 2;
+        Regrow(newRows);
+    }
 
-template<typename Func, typename... Ts>
-inline void ForEachPacked(
-    size_t begin,
-    size_t end,
-    Func&& func,
-    Ts*... ptrs
-){
-    for(size_t i = begin; i < end; ++i){
-        func(ptrs[i]...);
+    // Appends a row for e, the caller must construct every column at the returned row
+    uint32_t PushEntity(Entity e){
+        Reserve(count + 1);
+        size_t row = count++;
+        EntityAt(row) = e;
+        return (uint32_t)row;
     }
-}
 
-template<typename Func, typename... Ts>
-inline void ForEachPacked(
-    size_t begin,
-    size_t end,
-    Func&& func,
-    Entity* entities,
-    Ts*... ptrs
-){
-    for(size_t i = begin; i < end; ++i){
-        func(entities[i], ptrs[i]...);
+    void Remove(size_t row){
+        assert(false && "I think this is bug");
+        //Entity moved = entities.back();
+
+        for(auto& c : columns){
+            RemoveElement(c, row, count - 1);
+        }
+
+        //entities[row] = moved;
+        //entities.pop_back();
     }
-}
 
-template<typename F, typename... Args>
-constexpr bool AcceptsEntity = std::is_invocable_v<F, Entity, Args...>;
+    void Remove(size_t row, EntityLocations& locations){
+        size_t last = count - 1;
+        Entity moved = EntityAt(last);
 
-template<typename... Cs>
-struct View {
-    World* world;
-    Signature required;
+        for(auto& c : columns){
+            RemoveElement(c, row, last);
+        }
+        if(disabledTotal) RemoveRowBits(row, last);
 
-    std::vector<Archetype*> matched; 
+        EntityAt(row) = moved;
+        --count;
 
-    struct CachedArch {
-        size_t count;
-        std::tuple<Cs*...> ptrs;
-        std::vector<Entity>* entities;//New, for now this not slow down the peformace
-    };
-    std::vector<CachedArch> cached;
+        if(moved != InvalidEntity){
+            locations[EntityIndex(moved)].index = row;
+        }
 
-    View(World* w):world(w){
-        (required.set(GetComponentID<Cs>()), ...);
+        TrimBlocks();
     }
 
-    template<typename Func>
-    void Each(Func&& func){
-        for(auto& archPtr : world->archetypes){
-            Archetype& arch = *archPtr;
-
-            if(!arch.signature.Contains(required)) continue;
+    // Swap-removes every row in rows, which must be unique and sorted in descending order.
+    // Removing the highest row first means the tail that fills a hole is never itself doomed.
+    void RemoveRows(const std::pmr::vector<uint32_t>& rows, EntityLocations& locations){
+        for(auto& c : columns){
+            size_t last = count;
+            for(uint32_t row : rows){
+                --last;
+                RemoveElement(c, row, last);
+            }
+        }
 
-            if constexpr (AcceptsEntity<Func, Cs&...>){
-                Entity* entities = arch.entities.data();
-                ForEachPacked(
-                    0, arch.Size(),
-                    func,
-                    entities,
-                    arch.GetFast<Cs>()->data.data()...
-                );
-            } else {
-                ForEachPacked(
-                    0, arch.Size(),
-                    func,
-                    arch.GetFast<Cs>()->data.data()...
-                );
+        for(uint32_t row : rows){
+            size_t last = --count;
+            if(disabledTotal) RemoveRowBits(row, last);
+            Entity moved = EntityAt(last);
+            EntityAt(row) = moved;
+            if(row != last && moved != InvalidEntity){
+                locations[EntityIndex(moved)].index = row;
             }
         }
+
+        TrimBlocks();
     }
 
-    template<typename Func>
-    void EachCachedParallelBatch(tf::Taskflow& tf, Func&& func){
-        constexpr size_t CHUNK = 512;
+    // Destroys every row, the caller is responsible for the entities that lived here
+    void Clear(){
+        for(size_t b = 0; b < BlockCount(); ++b){
+            for(auto& c : columns){
+                DestroyRange(c, blocks[b] + c.offset, BlockSize(b));
+            }
+        }
+        count = 0;
+
+        for(auto& m : disabled){
+            std::fill(m.words.begin(), m.words.end(), 0);
+            m.count = 0;
+        }
+        disabledTotal = 0;
+
+        TrimBlocks();
+    }
+
+    bool IsDisabled(size_t mask, size_t row) const {
+        return (DisabledWord(mask, row >> 6) >> (row & 63)) & 1;
+    }
+
+    // Disabled bits of rows [64 * word, 64 * word + 64) in mask
+    uint64_t DisabledWord(size_t mask, size_t word) const {
+        if(mask >= disabled.size()) return 0;
+        const auto& words = disabled[mask].words;
+        return word < words.size() ? words[word] : 0;
+    }
+
+    void SetDisabled(size_t mask, size_t row, bool value){
+        if(value == IsDisabled(mask, row)) return;
+
+        if(disabled.empty()){
+            for(size_t m = 0; m <= columns.size(); ++m){
+                disabled.push_back({ std::pmr::vector<uint64_t>(resource), 0 });
+            }
+        }
+
+        RowMask& m = disabled[mask];
+        if(m.words.size() <= (row >> 6)) m.words.resize((row >> 6) + 1, 0);
+        m.words[row >> 6] ^= 1ull << (row & 63);
+
+        if(value){
+            m.count++;
+            disabledTotal++;
+        } else {
+            m.count--;
+            disabledTotal--;
+        }
+    }
+
+    // Bytes of column storage currently held, used or not
+    size_t ReservedBytes() const {
+        return blocks.size() * blockBytes;
+    }
+
+    // Gives spare blocks and capacity back to the resource, returns the bytes released.
+    // Contiguous storage is reallocated, so pointers into it are invalidated.
+    size_t ShrinkToFit(){
+        const size_t before = ReservedBytes();
+
+        if(layout == StorageLayout::Chunked){
+            while(blocks.size() > BlockCount()){
+                FreeBlock(blocks.back());
+                blocks.pop_back();
+            }
+        } else if(count == 0){
+            if(!blocks.empty()) FreeBlock(blocks[0]);
+            blocks.clear();
+            blockRows = 0;
+        } else {
+            // Same power of two steps Reserve grows by
+            size_t rows = 16;
+            while(rows < count) rows *= 2;
+            if(rows < blockRows) Regrow(rows);
+        }
+
+        return before - ReservedBytes();
+    }
+
+    // Migrates row into the unconstructed dstRow of dst and closes the hole with the last row.
+    // Every element is relocated exactly once, columns dst does not have are destroyed in place.
+    void MoveRowTo(Archetype& dst, size_t row, size_t dstRow, EntityLocations& locations){
+        const size_t last = count - 1;
+
+        // Disabled state follows the entity and the components it keeps
+        if(disabledTotal){
+            if(IsDisabled(0, row)) dst.SetDisabled(0, dstRow, true);
+            for(size_t c = 0; c < columns.size(); ++c){
+                if(!IsDisabled(1 + c, row)) continue;
+                uint16_t d = dst.ColumnIndex(columns[c].info->id);
+                if(d != Invalid) dst.SetDisabled(1 + d, dstRow, true);
+            }
+            RemoveRowBits(row, last);
+        }
+
+        // Both column lists are sorted by component id, so matching them is a merge walk
+        size_t d = 0;
+        for(auto& c : columns){
+            const ComponentID id = c.info->id;
+            while(d < dst.columns.size() && dst.columns[d].info->id < id) ++d;
+
+            if(d < dst.columns.size() && dst.columns[d].info->id == id){
+                RelocateElement(c, row, dst, dst.columns[d], dstRow);
+            } else if(!c.info->triviallyRelocatable){
+                c.info->destroy(Element(c, row));
+            }
+
+            if(row != last) RelocateElement(c, last, *this, c, row);
+        }
+
+        Entity moved = EntityAt(last);
+        EntityAt(row) = moved;
+        --count;
+
+        if(moved != InvalidEntity){
+            locations[EntityIndex(moved)].index = row;
+        }
+
+        TrimBlocks();
+    }
+
+    // Moves the T at src into the unconstructed row of column c, leaving src constructed
+    void EmplaceElement(const ComponentColumn& c, size_t row, void* src){
+        if(c.info->soaFields){
+            for(size_t f = 0; f < c.info->soaFields; ++f){
+                std::memcpy(FieldElement(c, f, row), static_cast<uint8_t*>(src) + f * c.info->fieldSize, c.info->fieldSize);
+            }
+        } else if(c.info->triviallyRelocatable){
+            std::memcpy(Element(c, row), src, c.size);
+        } else {
+            c.info->move(Element(c, row), src);
+        }
+    }
+
+private:
+    // Row is being removed and last moves into it
+    void RemoveRowBits(size_t row, size_t last){
+        for(size_t m = 0; m < disabled.size(); ++m){
+            if(disabled[m].count == 0) continue;
+
+            SetDisabled(m, row, false);
+            if(row != last && IsDisabled(m, last)){
+                SetDisabled(m, last, false);
+                SetDisabled(m, row, true);
+            }
+        }
+    }
+
+    // Keep one spare block so an entity bouncing on a block boundary does not thrash the allocator
+    void TrimBlocks(){
+        while(layout == StorageLayout::Chunked && blocks.size() > BlockCount() + 1){
+            FreeBlock(blocks.back());
+            blocks.pop_back();
+        }
+    }
+
+    // Returns the byte size of a block with the given rows, optionally assigning the column offsets
+    size_t Layout(size_t rows, bool assignOffsets){
+        size_t offset = rows * sizeof(Entity);
+        for(auto& c : columns){
+            offset = AlignUp(offset, std::max(ColumnAlign, c.info->align));
+            if(assignOffsets){
+                c.offset = offset;
+                if(c.info->soaFields) c.fieldPitch = SoAFieldPitch(rows, c.info->fieldSize);
+            }
+            offset += ColumnBytes(c, rows);
+        }
+        return AlignUp(offset, ColumnAlign);
+    }
+
+    static size_t ColumnBytes(const ComponentColumn& c, size_t rows){
+        if(c.info->soaFields) return c.info->soaFields * SoAFieldPitch(rows, c.info->fieldSize);
+        return rows * c.size;
+    }
+
+    // Contiguous layout only: moves every column into a single bigger block
+    void Regrow(size_t rows){
+        const size_t bytes = Layout(rows, false);
+        uint8_t* block = AllocateBlock(bytes);
+        uint8_t* old = blocks.empty() ? nullptr : blocks[0];
+
+        size_t offset = rows * sizeof(Entity);
+        if(old) std::memcpy(block, old, count * sizeof(Entity));
+
+        for(auto& c : columns){
+            offset = AlignUp(offset, std::max(ColumnAlign, c.info->align));
+            const size_t pitch = c.info->soaFields ? SoAFieldPitch(rows, c.info->fieldSize) : 0;
+            if(old && c.info->soaFields){
+                // The field pitch changes with the row count, so each field array moves on its own
+                for(size_t f = 0; f < c.info->soaFields; ++f){
+                    std::memcpy(block + offset + f * pitch, old + c.offset + f * c.fieldPitch, count * c.info->fieldSize);
+                }
+            } else if(old){
+                RelocateRange(c, block + offset, old + c.offset, count);
+            }
+            c.offset = offset;
+            c.fieldPitch = pitch;
+            offset += ColumnBytes(c, rows);
+        }
+
+        if(old){
+            FreeBlock(old);
+            blocks[0] = block;
+        } else {
+            blocks.push_back(block);
+        }
+        blockRows = rows;
+        blockBytes = bytes;
+    }
+
+    // Relocates row of column c into the unconstructed dstRow of column dc in dst
+    void RelocateElement(const ComponentColumn& c, size_t row, Archetype& dst, const ComponentColumn& dc, size_t dstRow){
+        if(c.info->soaFields){
+            for(size_t f = 0; f < c.info->soaFields; ++f){
+                std::memcpy(dst.FieldElement(dc, f, dstRow), FieldElement(c, f, row), c.info->fieldSize);
+            }
+            return;
+        }
+
+        RelocateRange(c, dst.Element(dc, dstRow), Element(c, row), 1);
+    }
+
+    // Swap-remove of one element: the tail is moved into the hole and destroyed
+    void RemoveElement(const ComponentColumn& c, size_t row, size_t last){
+        if(!c.info->triviallyRelocatable) c.info->destroy(Element(c, row));
+        if(row != last) RelocateElement(c, last, *this, c, row);
+    }
+
+    static void RelocateRange(const ComponentColumn& c, uint8_t* dst, uint8_t* src, size_t n){
+        if(c.info->triviallyRelocatable){
+            std::memcpy(dst, src, n * c.size);
+            return;
+        }
+
+        for(size_t i = 0; i < n; ++i){
+            c.info->move(dst + i * c.size, src + i * c.size);
+            c.info->destroy(src + i * c.size);
+        }
+    }
+
+    static void DestroyRange(const ComponentColumn& c, uint8_t* first, size_t n){
+        if(c.info->triviallyRelocatable) return;
+
+        for(size_t i = 0; i < n; ++i){
+            c.info->destroy(first + i * c.size);
+        }
+    }
+
+    uint8_t* AllocateBlock(size_t bytes){
+        return static_cast<uint8_t*>(resource->allocate(bytes, blockAlign));
+    }
+
+    // Blocks are always blockBytes big, Regrow frees the old block before updating it
+    void FreeBlock(uint8_t* block){
+        resource->deallocate(block, blockBytes, blockAlign);
+    }
+};
+
+// Archetypes live in the memory resource of their world
+struct ArchetypeDeleter{
+    std::pmr::memory_resource* resource = nullptr;
+
+    void operator()(Archetype* a) const {
+        a->~Archetype();
+        resource->deallocate(a, sizeof(Archetype), alignof(Archetype));
+    }
+};
+
+using ArchetypePtr = std::unique_ptr<Archetype, ArchetypeDeleter>;
+
+////////////////////////////////
+
+struct World;
+std::pmr::memory_resource* WorldResource(World* world);
+
+// Archetypes a query has to test, see World::CandidateArchetypes
+struct ArchetypeRange {
+    Archetype* const* first = nullptr;
+    Archetype* const* last = nullptr;
+
+    Archetype* const* begin() const { return first; }
+    Archetype* const* end() const { return last; }
+    size_t size() const { return size_t(last - first); }
+    Archetype* operator[](size_t i) const { return first[i]; }
+};
+
+// Archetypes matching an include/exclude pair. The World owns one per pair and every view
+// built from that pair shares it. The World keeps matched current as archetypes are created
+// and compacted, so iterating a query only reads it, see World::GetQuery and World::MatchQuery.
+struct Query {
+    Signature include;
+    Signature exclude;
+    std::pmr::vector<Signature> anyOf; // Archetypes need at least one component of each
+    std::pmr::vector<Archetype*> matched;
+    uint64_t version = 0; // Bumped whenever matched changes
+
+    explicit Query(std::pmr::memory_resource* resource):anyOf(resource),matched(resource){}
+
+    bool Matches(const Signature& sig) const {
+        if(!sig.Contains(include) || sig.Intersects(exclude)) return false;
+        for(const Signature& any : anyOf){
+            if(!sig.Intersects(any)) return false;
+        }
+        return true;
+    }
+};
+
+struct QueryKey {
+    Signature include;
+    Signature exclude;
+    std::pmr::vector<Signature> anyOf;
+
+    bool operator==(const QueryKey& other) const {
+        return include == other.include && exclude == other.exclude && anyOf == other.anyOf;
+    }
+};
+
+struct QueryKeyHash {
+    size_t operator()(const QueryKey& key) const {
+        size_t h = key.include.Hash() * 1099511628211ull ^ key.exclude.Hash();
+        for(const Signature& any : key.anyOf) h = h * 1099511628211ull ^ any.Hash();
+        return h;
+    }
+};
+
+inline uint32_t GetWorkerCount(uint32_t max = UINT32_MAX){
+    uint32_t n = std::thread::hardware_concurrency();
+    return n ? std::min(n, max) : 1;
+}
+
+////////////////////////////////
+
+// View terms. Optional<T> matches archetypes with or without T and hands the callback a T*,
+// null in archetypes lacking it. AnyOf<Ts...> matches archetypes holding at least one of Ts
+// and hands over a std::tuple<Ts*...> the same way.
+template<typename T>
+struct Optional {};
+
+template<typename... Ts>
+struct AnyOf {};
+
+// Archetypes holding any of Ts are skipped, see View(World*, Exclude<Es...>)
+template<typename... Ts>
+struct Exclude {};
+
+template<typename... Ts>
+constexpr Exclude<Ts...> exclude{};
+
+// Block column of an Optional term. step is 0 when the archetype lacks T, so base + i * step
+// stays null over the whole block and the row loop needs no branch.
+template<typename T>
+struct OptionalColumn {
+    T* base = nullptr;
+    size_t step = 0;
+};
+
+// Row i of a column. No alignment is assumed here, Archetype::Column hands out aligned bases.
+template<typename T>
+inline T& RowOf(T* column, size_t i){
+    return column[i];
+}
+
+template<typename T>
+inline T* RowOf(const OptionalColumn<T>& column, size_t i){
+    return column.base + i * column.step;
+}
+
+template<typename... Ts>
+inline std::tuple<Ts*...> RowOf(const std::tuple<OptionalColumn<Ts>...>& columns, size_t i){
+    return std::apply([&](const auto&... c){ return std::tuple<Ts*...>(RowOf(c, i)...); }, columns);
+}
+
+// How a view term is matched and read. A plain component is required and read by reference.
+template<typename T>
+struct ViewTerm {
+    using Param = T&;
+    using Column = T*;
+
+    static void Match(Signature& include, std::pmr::vector<Signature>&){
+        if constexpr (!IsSparse<T>) include.set(GetComponentID<T>());
+    }
+    static Column Fetch(Archetype& arch, size_t b){ return arch.Column<T>(b); }
+    static auto Span(Archetype& arch, size_t b){ return arch.ColumnSpan<T>(b); }
+    static T& At(Archetype* arch, size_t row){ return arch->At<T>(row); }
+
+    // Disabled mask of the column, see View::DisabledMasks
+    static uint16_t Mask(const Archetype& arch){
+        const uint16_t c = arch.ColumnIndex(GetComponentID<T>());
+        return c == Invalid ? 0 : uint16_t(1 + c);
+    }
+};
+
+// Optional and AnyOf components never hide a row, disabling one does not null its pointer
+template<typename T>
+struct ViewTerm<Optional<T>> {
+    static_assert(!IsSparse<T> && !IsSoA<T>, "Optional terms only support regular archetype components");
+
+    using Param = T*;
+    using Column = OptionalColumn<T>;
+
+    static void Match(Signature&, std::pmr::vector<Signature>&){}
+    static Column Fetch(Archetype& arch, size_t b){
+        if(!arch.Has(GetComponentID<T>())) return {};
+        return { arch.Column<T>(b), 1 };
+    }
+    static T* Span(Archetype& arch, size_t b){ return Fetch(arch, b).base; }
+    static T* At(Archetype* arch, size_t row){
+        return arch && arch->Has(GetComponentID<T>()) ? &arch->At<T>(row) : nullptr;
+    }
+    static uint16_t Mask(const Archetype&){ return 0; }
+};
+
+template<typename... Ts>
+struct ViewTerm<AnyOf<Ts...>> {
+    using Param = std::tuple<Ts*...>;
+    using Column = std::tuple<OptionalColumn<Ts>...>;
+
+    static void Match(Signature&, std::pmr::vector<Signature>& anyOf){
+        anyOf.push_back(Signature::Make<Ts...>());
+    }
+    static Column Fetch(Archetype& arch, size_t b){ return { ViewTerm<Optional<Ts>>::Fetch(arch, b)... }; }
+    static Param Span(Archetype& arch, size_t b){ return { ViewTerm<Optional<Ts>>::Span(arch, b)... }; }
+    static Param At(Archetype* arch, size_t row){ return { ViewTerm<Optional<Ts>>::At(arch, row)... }; }
+    static uint16_t Mask(const Archetype&){ return 0; }
+};
+
+template<typename T>
+using TermParam = typename ViewTerm<T>::Param;
+
+template<typename T>
+using TermColumn = typename ViewTerm<T>::Column;
+
+// Calls func with row i of every column, an Entity* column hands over the entity ID
+template<typename Func, typename... Ps>
+inline void ForEachPacked(
+    size_t begin,
+    size_t end,
+    Func&& func,
+    Ps... columns
+){
+    for(size_t i = begin; i < end; ++i){
+        func(RowOf(columns, i)...);
+    }
+}
+
+// ForEachPacked over [begin, end) of a block starting at archetype row rowBase, skipping rows
+// disabled in any of masks. Works a word of 64 rows at a time, fully enabled words take the
+// packed loop unchanged.
+template<size_t N, typename Func, typename... Ps>
+inline void ForEachEnabled(
+    const Archetype& arch,
+    const std::array<uint16_t, N>& masks,
+    size_t rowBase,
+    size_t begin,
+    size_t end,
+    Func&& func,
+    Ps... ptrs
+){
+    if(arch.disabledTotal == 0){
+        ForEachPacked(begin, end, func, ptrs...);
+        return;
+    }
+
+    for(size_t i = begin; i < end;){
+        const size_t row = rowBase + i;
+        const size_t bit = row & 63;
+        const size_t n = std::min(64 - bit, end - i);
+
+        uint64_t off = 0;
+        for(uint16_t m : masks) off |= arch.DisabledWord(m, row >> 6);
+
+        const uint64_t range = n == 64 ? ~0ull : (1ull << n) - 1;
+        const uint64_t live = ~(off >> bit) & range;
+        if(live == range){
+            ForEachPacked(i, i + n, func, ptrs...);
+        } else {
+            for(uint64_t bits = live; bits; bits &= bits - 1){
+                const size_t j = i + CountTrailingZeros64(bits);
+                ForEachPacked(j, j + 1, func, ptrs...);
+            }
+        }
+        i += n;
+    }
+}
+
+// Calls func(begin, end) for every run of [0, count) enabled under masks, rowBase as in
+// ForEachEnabled. Runs are found a word of 64 rows at a time.
+template<size_t N, typename Func>
+inline void ForEachEnabledRun(
+    const Archetype& arch,
+    const std::array<uint16_t, N>& masks,
+    size_t rowBase,
+    size_t count,
+    Func&& func
+){
+    size_t runBegin = 0;
+    bool inRun = false;
+
+    for(size_t i = 0; i < count;){
+        const size_t row = rowBase + i;
+        const size_t bit = row & 63;
+        const size_t n = std::min(64 - bit, count - i);
+
+        uint64_t off = 0;
+        for(uint16_t m : masks) off |= arch.DisabledWord(m, row >> 6);
+
+        const uint64_t range = n == 64 ? ~0ull : (1ull << n) - 1;
+        const uint64_t live = ~(off >> bit) & range;
+
+        // Alternate between runs of set and clear bits, the bits past n are clear
+        for(size_t pos = 0; pos < n;){
+            const uint64_t rest = live >> pos;
+            if(rest & 1){
+                if(!inRun){
+                    runBegin = i + pos;
+                    inRun = true;
+                }
+                pos += ~rest ? CountTrailingZeros64(~rest) : 64 - pos;
+            } else {
+                if(inRun){
+                    func(runBegin, i + pos);
+                    inRun = false;
+                }
+                pos += rest ? CountTrailingZeros64(rest) : 64 - pos;
+            }
+        }
+        i += n;
+    }
+
+    if(inRun) func(runBegin, count);
+}
+
+// A block span moved forward by n rows, see View::EachBlock
+template<typename T>
+inline T* SpanAt(T* span, size_t n){
+    return span ? span + n : nullptr;
+}
+
+template<typename T>
+inline SoAColumn<T> SpanAt(SoAColumn<T> span, size_t n){
+    span.offset += n;
+    return span;
+}
+
+template<typename... Ts>
+inline std::tuple<Ts*...> SpanAt(const std::tuple<Ts*...>& spans, size_t n){
+    return std::apply([&](auto*... p){ return std::tuple<Ts*...>(SpanAt(p, n)...); }, spans);
+}
+
+template<typename F, typename... Args>
+constexpr bool AcceptsEntity = std::is_invocable_v<F, Entity, Args...>;
+
+template<typename... Cs>
+struct View {
+    static constexpr bool HasSparse = (IsSparse<Cs> || ...);
+
+    World* world;
+    Signature required; // Archetype components only, sparse ones are joined per entity
+    Signature exclude;
+    Query* query;       // Shared with every other view of the same terms
+
+    using DisabledMaskList = std::array<uint16_t, 1 + sizeof...(Cs)>;
+
+    struct CachedArch {
+        size_t count;
+        std::tuple<TermColumn<Cs>...> ptrs;
+        Entity* entities;//New, for now this not slow down the peformace
+        const Archetype* archetype;
+        size_t rowBase;
+        DisabledMaskList masks;
+    };
+    std::pmr::vector<CachedArch> cached;
+
+    // Cache state, see Refresh
+    uint64_t cachedQueryVersion = ~0ull;
+    uint64_t cachedVersion = ~0ull;
+
+    View(World* w):View(w, Exclude<>{}){}
+
+    template<typename... Es>
+    View(World* w, Exclude<Es...>):world(w),cached(WorldResource(w)){
+        static_assert(!(IsSparse<Es> || ...), "Sparse components are not part of archetype signatures");
+
+        std::pmr::vector<Signature> anyOf(WorldResource(w));
+        (ViewTerm<Cs>::Match(required, anyOf), ...);
+        exclude = Signature::Make<Es...>();
+        query = world->GetQuery(required, exclude, anyOf);
+    }
+
+    // The shared match list. The World keeps it current, iterating only reads it.
+    const std::pmr::vector<Archetype*>& Matched() const {
+        return query->matched;
+    }
+
+    template<typename Func>
+    void Each(Func&& func){
+        if constexpr (HasSparse){
+            EachSparse(func);
+        } else {
+            for(Archetype* archPtr : Matched()){
+                Archetype& arch = *archPtr;
+
+                const DisabledMaskList masks = DisabledMasks(arch);
+                for(size_t b = 0; b < arch.BlockCount(); ++b){
+                    if constexpr (AcceptsEntity<Func, TermParam<Cs>...>){
+                        ForEachEnabled(
+                            arch, masks, b << arch.blockShift,
+                            0, arch.BlockSize(b),
+                            func,
+                            arch.Entities(b),
+                            ViewTerm<Cs>::Fetch(arch, b)...
+                        );
+                    } else {
+                        ForEachEnabled(
+                            arch, masks, b << arch.blockShift,
+                            0, arch.BlockSize(b),
+                            func,
+                            ViewTerm<Cs>::Fetch(arch, b)...
+                        );
+                    }
+                }
+            }
+        }
+    }
+
+    // Each already passes the entity to callbacks taking one first
+    template<typename Func>
+    void EachWithEntity(Func&& func){
+        Each(func);
+    }
+
+    // Walks the smallest sparse set of the view and keeps the entities that have every other
+    // component, archetype ones are read from the row the entity lives in
+    template<typename Func>
+    void EachSparse(Func&& func){
+        SparseSetBase* driver = nullptr;
+        bool missing = false;
+        ([&]{
+            if constexpr (IsSparse<Cs>){
+                SparseSetBase* set = FindSparseSet<Cs>();
+                if(!set) missing = true;
+                else if(!driver || set->Size() < driver->Size()) driver = set;
+            }
+        }(), ...);
+        if(missing) return;
+
+        const bool needsArchetype = required.summary != 0 || !query->anyOf.empty();
+        for(size_t i = 0; i < driver->Size(); ++i){
+            const Entity e = driver->dense[i];
+            if(!(SparseHas<Cs>(e) && ...)) continue;
+
+            const EntityLocation& loc = world->locations[EntityIndex(e)];
+            Archetype* arch = world->archetypeByIndex[loc.archetype];
+            if(arch ? !query->Matches(arch->signature) : needsArchetype) continue;
+            if(arch && arch->disabledTotal && IsRowDisabled(*arch, loc.index)) continue;
+
+            if constexpr (AcceptsEntity<Func, TermParam<Cs>...>){
+                func(e, Fetch<Cs>(arch, loc.index, e)...);
+            } else {
+                func(Fetch<Cs>(arch, loc.index, e)...);
+            }
+        }
+    }
+
+    // Masks that hide a row from this view: the entity one and those of the columns it reads
+    static DisabledMaskList DisabledMasks(const Archetype& arch){
+        return { 0, ViewTerm<Cs>::Mask(arch)... };
+    }
+
+    static bool IsRowDisabled(const Archetype& arch, size_t row){
+        return IsRowDisabled(arch, DisabledMasks(arch), row);
+    }
+
+    static bool IsRowDisabled(const Archetype& arch, const DisabledMaskList& masks, size_t row){
+        for(uint16_t m : masks){
+            if(arch.IsDisabled(m, row)) return true;
+        }
+        return false;
+    }
+
+    template<typename T>
+    SparseSet<T>* FindSparseSet(){
+        const ComponentID id = GetComponentID<T>();
+        if(id >= world->sparseSets.size()) return nullptr;
+        return static_cast<SparseSet<T>*>(world->sparseSets[id].get());
+    }
+
+    template<typename T>
+    bool SparseHas(Entity e){
+        if constexpr (IsSparse<T>) return FindSparseSet<T>()->Has(e);
+        else return true;
+    }
+
+    template<typename T>
+    TermParam<T> Fetch(Archetype* arch, size_t row, Entity e){
+        if constexpr (IsSparse<T>) return FindSparseSet<T>()->Get(e);
+        else return ViewTerm<T>::At(arch, row);
+    }
+
+    // Calls func(count, columns...) once per block. A column is a Cs* for regular components
+    // and an SoAColumn<Cs> for SoA ones, so the callback can run over whole field arrays.
+    // Optional terms give a T* that may be null, AnyOf terms a tuple of them.
+    // A block with disabled rows is handed over as its runs of enabled rows instead, those
+    // columns start past the block base and lose the ColumnAlign guarantee.
+    template<typename Func>
+    void EachBlock(Func&& func){
+        static_assert(!HasSparse, "Views with sparse components only support Each");
+        for(Archetype* archPtr : Matched()){
+            Archetype& arch = *archPtr;
+
+            const DisabledMaskList masks = DisabledMasks(arch);
+            for(size_t b = 0; b < arch.BlockCount(); ++b){
+                if(arch.disabledTotal == 0){
+                    func(arch.BlockSize(b), ViewTerm<Cs>::Span(arch, b)...);
+                    continue;
+                }
+
+                ForEachEnabledRun(arch, masks, b << arch.blockShift, arch.BlockSize(b), [&](size_t begin, size_t end){
+                    func(end - begin, SpanAt(ViewTerm<Cs>::Span(arch, b), begin)...);
+                });
+            }
+        }
+    }
+
+    template<typename Func>
+    void EachCachedParallelBatch(tf::Taskflow& tf, Func&& func){
+        constexpr size_t CHUNK = 512;
+
+        // The tasks copy the entries, run them before the next structural change
+        Refresh();
 
         for(auto& c : cached){
             const size_t count = c.count;
@@ -398,17 +1740,19 @@ struct View {
 
                 tf.emplace([c, func, begin, end](){
                     std::apply(
-                        [&](auto*... ptrs){
-                        if constexpr (AcceptsEntity<Func, Cs&...>){
-                            ForEachPacked(
+                        [&](const auto&... ptrs){
+                        if constexpr (AcceptsEntity<Func, TermParam<Cs>...>){
+                            ForEachEnabled(
+                                *c.archetype, c.masks, c.rowBase,
                                 begin,
                                 end,
                                 func,
-                                c.entities->data(),
+                                c.entities,
                                 ptrs...
                             );
                         } else {
-                            ForEachPacked(
+                            ForEachEnabled(
+                                *c.archetype, c.masks, c.rowBase,
                                 begin,
                                 end,
                                 func,
@@ -427,6 +1771,10 @@ struct View {
     void EachCachedParallelSingle(tf::Taskflow& tf, Func&& func){
         constexpr size_t CHUNK = 512;
 
+        // Refreshed here and not in the task, views sharing a query would update it from
+        // several workers. The task reads the cache, run it before the next structural change.
+        Refresh();
+
         tf.emplace([&, func](){
         for(auto& c : cached){
             const size_t count = c.count;
@@ -438,17 +1786,19 @@ struct View {
                 const size_t begin = t * CHUNK;
                 const size_t end   = std::min(begin + CHUNK, count);
                     std::apply(
-                        [&](auto*... ptrs){
-                        if constexpr (AcceptsEntity<Func, Cs&...>){
-                            ForEachPacked(
+                        [&](const auto&... ptrs){
+                        if constexpr (AcceptsEntity<Func, TermParam<Cs>...>){
+                            ForEachEnabled(
+                                *c.archetype, c.masks, c.rowBase,
                                 begin,
                                 end,
                                 func,
-                                c.entities->data(),
+                                c.entities,
                                 ptrs...
                             );
                         } else {
-                            ForEachPacked(
+                            ForEachEnabled(
+                                *c.archetype, c.masks, c.rowBase,
                                 begin,
                                 end,
                                 func,
@@ -463,40 +1813,59 @@ struct View {
         });
     }
 
+    // Forces a full rebuild of the cache. The cached Each variants refresh on their own, so
+    // calling this once after creating the view is enough.
     void CachArchetypes(){
-        cached.clear();
-        cached.reserve(world->archetypes.size());
-
-        for(auto& a : world->archetypes){
-            if(!a->signature.Contains(required))
-                continue;
+        static_assert(!HasSparse, "Views with sparse components only support Each");
+        cachedVersion = ~0ull;
+        Refresh();
+    }
 
-            CachedArch c;
-            c.count = a->Size();
-            c.ptrs  = std::tuple<Cs*...>{
-                a->GetFast<Cs>()->data.data()...
-            };
-            c.entities = &a->entities;
+    // Brings the cache up to date. The per block entries are re-read only when the match list
+    // or the world structural version moved, so an unchanged world costs a few compares.
+    void Refresh(){
+        const auto& matched = Matched();
+        if(cachedQueryVersion == query->version && cachedVersion == world->structuralVersion) return;
+        cachedQueryVersion = query->version;
+        cachedVersion = world->structuralVersion;
 
-            cached.emplace_back(c);
+        // One cache entry per block
+        cached.clear();
+        for(Archetype* a : matched){
+            for(size_t b = 0; b < a->BlockCount(); ++b){
+                CachedArch c;
+                c.count = a->BlockSize(b);
+                c.ptrs  = std::tuple<TermColumn<Cs>...>{
+                    ViewTerm<Cs>::Fetch(*a, b)...
+                };
+                c.entities = a->Entities(b);
+                c.archetype = a;
+                c.rowBase = b << a->blockShift;
+                c.masks = DisabledMasks(*a);
+
+                cached.emplace_back(c);
+            }
         }
     }
 
     template<typename Func>
     void EachCached(Func&& func){
+        Refresh();
         for(auto& c : cached){
             std::apply(
-                [&](auto*... ptrs){
-                    if constexpr (AcceptsEntity<Func, Cs&...>){
-                        ForEachPacked(
+                [&](const auto&... ptrs){
+                    if constexpr (AcceptsEntity<Func, TermParam<Cs>...>){
+                        ForEachEnabled(
+                            *c.archetype, c.masks, c.rowBase,
                             0,
                             c.count,
                             func,
-                            c.entities->data(),
+                            c.entities,
                             ptrs...
                         );
                     } else {
-                        ForEachPacked(
+                        ForEachEnabled(
+                            *c.archetype, c.masks, c.rowBase,
                             0,
                             c.count,
                             func,
@@ -509,603 +1878,553 @@ struct View {
         }
     }
 
-    void CachArchetypes2(){
-        matched.clear();
-        for(auto& a : world->archetypes){
-            if(a->signature.Contains(required)){
-                matched.push_back(a.get());
-            }
-        }
-    }
+    // Kept for callers of the old API, the shared query is already current
+    void CachArchetypes2(){}
 
     template<typename Func>
     void EachCached2(Func&& func){
-        for(auto* arch: matched){
-            ForEachPacked(
-                0, arch->Size(),
-                func,
-                arch->GetFast<Cs>()->data.data()...
-            );
-        }
-    }
-
-    template<typename Func>
-    void _Each(Func&& func){
-        for(auto& archPtr : world->archetypes){
-            Archetype& arch = *archPtr;
-
-            if(!arch.signature.Contains(required)) continue;
-
-            auto arrays = std::tuple{ arch.Get<Cs>()... };
-
-            for(size_t i = 0; i < arch.Size(); ++i){
-                std::apply(
-                    [&](auto*... arr) {
-                        func(arr->data[i]...);
-                    },
-                    arrays
+        for(auto* arch: query->matched){
+            const DisabledMaskList masks = DisabledMasks(*arch);
+            for(size_t b = 0; b < arch->BlockCount(); ++b){
+                ForEachEnabled(
+                    *arch, masks, b << arch->blockShift,
+                    0, arch->BlockSize(b),
+                    func,
+                    ViewTerm<Cs>::Fetch(*arch, b)...
                 );
             }
         }
     }
 
-    template<typename Func>
-    void _Each2(Func&& func){
-        for(auto& archPtr : world->archetypes){
-            Archetype& arch = *archPtr;
-
-            if(!arch.signature.Contains(required)) continue;
-
-            auto arrays = std::tuple{ arch.Get<Cs>()->data.data()... };
+    struct Iterator{
+        View* view; 
+        size_t archIndex;
+        size_t block;
+        size_t index;
+        size_t count;
 
-            for(size_t i = 0; i < arch.Size(); ++i){
-                std::apply(
-                    [&](auto*... arr) {
-                        func(arr[i]...);
-                    },
-                    arrays
-                );
-            }
-        }
-    }
+        std::tuple<TermColumn<Cs>...> ptrs;
+        const Archetype* arch = nullptr;
+        DisabledMaskList masks{};
 
-    /*template<typename Func, typename... Ts>
-    inline void ForEachPacked(
-        size_t begin,
-        size_t end,
-        Func&& func,
-        Ts*... ptrs
-    ){
-        for(size_t i = begin; i < end; ++i){
-            func(ptrs[i]...);
+        bool RowDisabled() const {
+            return arch->disabledTotal && IsRowDisabled(*arch, masks, (block << arch->blockShift) + index);
         }
-    }*/
-
-    template<typename Func>
-    void _Each3(Func&& func){
-        for(auto& archPtr : world->archetypes){
-            Archetype& arch = *archPtr;
 
-            if(!arch.signature.Contains(required)) continue;
-
-            //auto arrays = std::tuple{ arch.Get<Cs>()->data.data()... };
+        // Moves to the next enabled row at or after (block, index), across archetypes
+        void SkipInvalid(){
+            const auto& archetypes = view->query->matched;
 
-            ForEachPacked(
-                0, arch.Size(),
-                func,
-                arch.GetFast<Cs>()->data.data()...
-            );
-        }
-    }
+            while(archIndex < archetypes.size()){
+                Archetype& a = *archetypes[archIndex];
 
-    template<typename Func>
-    void _EachWithEntity(Func&& func) {
-        for(auto& archPtr : world->archetypes){
-            Archetype& arch = *archPtr;
+                if(block < a.BlockCount()){
+                    if(arch != &a){
+                        arch = &a;
+                        masks = DisabledMasks(a);
+                    }
+                    count = a.BlockSize(block);
+                    ptrs = std::tuple<TermColumn<Cs>...>{
+                        ViewTerm<Cs>::Fetch(a, block)...
+                    };
 
-            if(!arch.signature.Contains(required)) continue;
+                    while(index < count && RowDisabled()) ++index;
+                    if(index < count) return;
 
-            auto arrays = std::tuple{ arch.Get<Cs>()... };
+                    ++block;
+                    index = 0;
+                    continue;
+                }
 
-            for(size_t i = 0; i < arch.Size(); ++i){
-                Entity e = arch.entities[i];
-                std::apply(
-                    [&](auto*... arr) {
-                        func(e, arr->data[i]...);
-                    },
-                    arrays
-                );
+                ++archIndex;
+                block = 0;
             }
-        }
-    }
-
-    template<typename Func>
-    void _EachParallel(Func&& func){
-        const uint32_t hw = GetWorkerCount();
-
-        for(auto& archPtr : world->archetypes){
-            Archetype& arch = *archPtr;
-
-            if(!arch.signature.Contains(required))
-                continue;
-
-            const size_t count = arch.Size();
-            if(count == 0)
-                continue;
-
-            auto arrays = std::tuple{ arch.Get<Cs>()... };
 
-            const uint32_t workers = std::min<uint32_t>(hw, (uint32_t)count);
-            const size_t chunkSize = (count + workers - 1) / workers;
-
-            std::vector<std::thread> threads;
-            threads.reserve(workers);
+            count = 0;
+        }
 
-            for(uint32_t t = 0; t < workers; ++t){
-                const size_t begin = t * chunkSize;
-                if(begin >= count) break;
+        Iterator(View* v, size_t a, size_t i):view(v),archIndex(a),block(0),index(i),count(0){
+            SkipInvalid();
+        }
 
-                const size_t end = std::min(begin + chunkSize, count);
+        inline auto operator*() const noexcept {
+            return std::apply(
+                [&](const auto&... p) {
+                    return std::tuple<TermParam<Cs>...>(RowOf(p, index)...);
+                },
+                ptrs
+            );
+        }
 
-                threads.emplace_back(
-                    [&, begin, end]() {
-                        for(size_t i = begin; i < end; ++i){
-                            std::apply(
-                                [&](auto*... arr){
-                                    func(arr->data[i]...);
-                                },
-                                arrays
-                            );
-                        }
-                    }
-                );
+        Iterator& operator++(){
+            ++index;
+            if(index >= count){
+                ++block;
+                index = 0;
+                SkipInvalid();
+            } else if(RowDisabled()){
+                SkipInvalid();
             }
-
-            for(auto& th : threads)
-                th.join();
+            return *this;
         }
-    }
 
-    template<typename Func>
-    void _EachParallel(tf::Executor& executor, Func&& func){
-        tf::Taskflow tf;
-        const uint32_t hw = executor.num_workers();
+        bool operator==(const Iterator& other) const {
+            return archIndex == other.archIndex && block == other.block && index == other.index;
+        }
 
-        for(auto& archPtr : world->archetypes){
-            Archetype& arch = *archPtr;
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+    };
 
-            if(!arch.signature.Contains(required)) continue;
+    Iterator begin(){ return Iterator{ this, 0, 0 }; }
+    Iterator end(){ return Iterator{ this, Matched().size(), 0 }; }
+};
 
-            const size_t count = arch.Size();
-            if(count == 0) continue;
+////////////////////////////////
 
-            auto arrays = std::tuple{ arch.Get<Cs>()... };
+// Kept for code written against the old separate type, View handles exclusion itself
+template<typename... Cs>
+using ViewWithExclude = View<Cs...>;
 
-            const uint32_t workers = std::min<uint32_t>(hw, (uint32_t)count);
-            const size_t chunkSize = (count + workers - 1) / workers;
+// Components staged for World::AddBatch. Values are placed in an inline buffer and spill into
+// a heap buffer that survives Clear, so a batch reused across entities does no allocation.
+struct ComponentBatch{
+    static constexpr size_t InlineBytes = 256;
+    static constexpr size_t MaxAlign = 64;
 
-            std::vector<std::thread> threads;
-            threads.reserve(workers);
+    struct Entry{
+        ComponentID id;
+        bool spilled;
+        uint32_t offset;
+    };
 
-            for(uint32_t t = 0; t < workers; ++t){
-                const size_t begin = t * chunkSize;
-                if(begin >= count) break;
+    Signature sig;
+    std::vector<Entry> entries;
 
-                const size_t end = std::min(begin + chunkSize, count);
+    ComponentBatch() = default;
+    ComponentBatch(const ComponentBatch&) = delete;
+    ComponentBatch& operator=(const ComponentBatch&) = delete;
 
-                tf.emplace(
-                    [&, begin, end]() {
-                        for(size_t i = begin; i < end; ++i){
-                            std::apply(
-                                [&](auto*... arr){
-                                    func(arr->data[i]...);
-                                },
-                                arrays
-                            );
-                        }
-                    }
-                );
-            }
-        }
-        executor.run(tf).wait();
+    ~ComponentBatch(){
+        Clear();
+        ::operator delete(spill, std::align_val_t(MaxAlign));
     }
 
-    template<typename Func>
-    void _EachParallel2(tf::Executor& executor, Func&& func){
-        tf::Taskflow tf;
-
-        constexpr size_t CHUNK_SIZE = 512;
-
-        for(auto& archPtr : world->archetypes){
-            Archetype& arch = *archPtr;
-
-            if(!arch.signature.Contains(required)) continue;
-
-            const size_t count = arch.Size();
-            if(count == 0) continue;
-
-            auto arrays = std::tuple{ arch.Get<Cs>()... };
-
-            // Small archetypes: run single-threaded
-            if(count <= CHUNK_SIZE){
-                for(size_t i = 0; i < count; ++i) {
-                    std::apply(
-                        [&](auto*... arr) {
-                            func(arr->data[i]...);
-                        },
-                        arrays
-                    );
-                }
-                continue;
-            }
+    template<typename T>
+    void Add(T&& value){
+        using C = std::decay_t<T>;
+        static_assert(alignof(C) <= MaxAlign, "Component alignment too large for ComponentBatch");
+        static_assert(!IsSparse<C>, "Sparse components are added with World::AddComponent");
 
-            const size_t taskCount = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        ComponentID id = GetComponentID<C>();
+        assert(ComponentInfos()[id].size != 0 && "Component not registered");
+        sig.set(id);
 
-            for(size_t t = 0; t < taskCount; ++t){
-                const size_t begin = t * CHUNK_SIZE;
-                const size_t end   = std::min(begin + CHUNK_SIZE, count);
-
-                tf.emplace([&, begin, end](){
-                    for(size_t i = begin; i < end; ++i){
-                        std::apply(
-                            [&](auto*... arr) {
-                                func(arr->data[i]...);
-                            },
-                            arrays
-                        );
-                    }
-                });
-            }
+        // Tags only need the signature bit
+        if constexpr (!std::is_empty_v<C>){
+            Entry entry = Allocate(id, sizeof(C), alignof(C));
+            new(Data(entry)) C(std::forward<T>(value));
+            entries.push_back(entry);
         }
-
-        executor.run(tf).wait();
     }
 
-    template<typename Func>
-    void _EachParallel3(tf::Executor& executor, Func&& func){
-        tf::Taskflow tf;
-
-        for(auto& archPtr : world->archetypes){
-            Archetype& arch = *archPtr;
-
-            if(!arch.signature.Contains(required))
-                continue;
-
-            const size_t count = arch.Size();
-            if(count == 0)
-                continue;
-
-            // Resolve raw pointers ONCE (same as fast iterator)
-            auto ptrs = std::tuple{
-                arch.GetFast<Cs>()->data.data()...
-            };
-
-            constexpr size_t CHUNK = 512;
-            const size_t taskCount = (count + CHUNK - 1) / CHUNK;
-
-            for(size_t t = 0; t < taskCount; ++t){
-                const size_t begin = t * CHUNK;
-                const size_t end   = std::min(begin + CHUNK, count);
+    void* Data(const Entry& e){
+        return (e.spilled ? spill : inlineBuffer) + e.offset;
+    }
 
-                tf.emplace([&, begin, end, ptrs]() mutable {
-                    for(size_t i = begin; i < end; ++i){
-                        // tight hot loop
-                        std::apply(
-                            [&](auto*... p){
-                                func(p[i]...);
-                            },
-                            ptrs
-                        );
-                    }
-                });
-            }
+    void Clear(){
+        for(auto& e : entries){
+            const ComponentInfo& info = ComponentInfos()[e.id];
+            if(!info.triviallyRelocatable) info.destroy(Data(e));
         }
 
-        executor.run(tf).wait();
+        entries.clear();
+        sig = {};
+        inlineUsed = 0;
+        spillUsed = 0;
     }
 
-    template<typename Func>
-    void _EachParallel4(tf::Executor& executor, Func&& func){
-        tf::Taskflow tf;
-
-        for(auto& archPtr : world->archetypes){
-            Archetype& arch = *archPtr;
-
-            if(!arch.signature.Contains(required)) continue;
-
-            const size_t count = arch.Size();
-            if(count == 0) continue;
-
-            constexpr size_t CHUNK = 512;
-            const size_t taskCount = (count + CHUNK - 1) / CHUNK;
+private:
+    alignas(MaxAlign) uint8_t inlineBuffer[InlineBytes];
+    size_t inlineUsed = 0;
 
-            for(size_t t = 0; t < taskCount; ++t){
-                const size_t begin = t * CHUNK;
-                const size_t end   = std::min(begin + CHUNK, count);
+    uint8_t* spill = nullptr;
+    size_t spillUsed = 0;
+    size_t spillCapacity = 0;
 
-                tf.emplace([&, begin, end]() mutable {
-                    ForEachPacked(
-                        begin, end,
-                        func,
-                        arch.GetFast<Cs>()->data.data()...
-                    );
-                });
-            }
+    Entry Allocate(ComponentID id, size_t size, size_t align){
+        size_t offset = AlignUp(inlineUsed, align);
+        if(offset + size <= InlineBytes){
+            inlineUsed = offset + size;
+            return { id, false, (uint32_t)offset };
         }
 
-        executor.run(tf).wait();
+        offset = AlignUp(spillUsed, align);
+        if(offset + size > spillCapacity) GrowSpill(offset + size);
+        spillUsed = offset + size;
+        return { id, true, (uint32_t)offset };
     }
-    
-    template<typename Func>
-    void _EachParallel5(tf::Executor& executor, Func&& func){
-        tf::Taskflow tf;
 
-        constexpr size_t CHUNK = 512;
-
-        for(auto& c : cached){
-            const size_t count = c.count;
-            if(count == 0) continue;
-
-            const size_t taskCount = (count + CHUNK - 1) / CHUNK;
+    // Relocates the spilled values into a bigger buffer, offsets stay the same
+    void GrowSpill(size_t bytes){
+        size_t capacity = std::max(spillCapacity * 2, InlineBytes);
+        while(capacity < bytes) capacity *= 2;
 
-            for(size_t t = 0; t < taskCount; ++t){
-                const size_t begin = t * CHUNK;
-                const size_t end   = std::min(begin + CHUNK, count);
+        uint8_t* buffer = static_cast<uint8_t*>(::operator new(capacity, std::align_val_t(MaxAlign)));
+        for(auto& e : entries){
+            if(!e.spilled) continue;
 
-                tf.emplace([c, func, begin, end](){
-                    std::apply(
-                        [&](auto*... ptrs){
-                            ForEachPacked(
-                                begin,
-                                end,
-                                func,
-                                ptrs...
-                            );
-                        },
-                        c.ptrs
-                    );
-                });
+            const ComponentInfo& info = ComponentInfos()[e.id];
+            if(info.triviallyRelocatable){
+                std::memcpy(buffer + e.offset, spill + e.offset, info.size);
+            } else {
+                info.move(buffer + e.offset, spill + e.offset);
+                info.destroy(spill + e.offset);
             }
         }
 
-        executor.run(tf).wait();
+        ::operator delete(spill, std::align_val_t(MaxAlign));
+        spill = buffer;
+        spillCapacity = capacity;
     }
+};
 
-    template<typename Func>
-    void _EachParallel6(tf::Taskflow& tf, Func&& func){
-        for(auto& archPtr : world->archetypes){
-            Archetype* arch = archPtr.get();
-
-            if(!arch->signature.Contains(required)) continue;
-
-            const size_t count = arch->Size();
-            if(count == 0) continue;
-
-            constexpr size_t CHUNK = 512;
-            const size_t taskCount = (count + CHUNK - 1) / CHUNK;
+struct World {
+    // Archetypes, their blocks and every World container allocate from here. It must outlive the world.
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource();
 
-            for(size_t t = 0; t < taskCount; ++t){
-                const size_t begin = t * CHUNK;
-                const size_t end   = std::min(begin + CHUNK, count);
+    Entity nextEntity = 0;
+    EntityLocations locations{resource};
+    PagedArray<EntityGeneration> generations{resource}; // Live generation of every index
+    std::pmr::vector<ArchetypePtr> archetypes{resource};
+    std::pmr::vector<Archetype*> archetypeByIndex{ 1, nullptr, resource }; // Dense, [0] is no archetype
+    std::pmr::vector<SparseSetPtr> sparseSets{resource};        // By ComponentID, null until first use
+    std::pmr::vector<SparseSetBase*> activeSparseSets{resource}; // The non null sparseSets
+
+    // Inverted index: the archetypes containing each component, tags included, by ComponentID
+    std::pmr::vector<std::pmr::vector<Archetype*>> componentArchetypes{resource};
+
+    // Query registry, one shared match list per include/exclude pair. Nodes never move, so
+    // views keep plain Query pointers.
+    std::pmr::unordered_map<QueryKey, Query, QueryKeyHash> queries{resource};
+
+    // Bumped by every operation that adds, removes or moves rows. Cached views compare it to
+    // know when their block pointers and counts are stale.
+    uint64_t structuralVersion = 0;
+    std::pmr::vector<Entity> freeList{resource}; // Free indices
+    StorageLayout layout = StorageLayout::Contiguous;
+
+    World() = default;
+    explicit World(StorageLayout layout):layout(layout){}
+    explicit World(std::pmr::memory_resource* resource, StorageLayout layout = StorageLayout::Contiguous)
+        :resource(resource),layout(layout){}
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
 
-                tf.emplace([func, arch, begin, end]() mutable {
-                    ForEachPacked(
-                        begin, end,
-                        func,
-                        arch->GetFast<Cs>()->data.data()...
-                    );
-                });
-            }
+    Entity CreateEntity(){
+        if(!freeList.empty()){
+            Entity index = freeList.back();
+            freeList.pop_back();
+            locations[index] = {};
+            return MakeEntity(index, generations[index]);
         }
+        
+        Entity index = NewEntityIndex();
+        locations.resize(index+1);
+        generations.resize(index+1);
+        locations[index] = {};
+        return index;
     }
 
-    struct Iterator{
-        View* view; 
-        size_t archIndex;
-        size_t index;
-        size_t count;
+    Entity NewEntityIndex(){
+        // The last index is reserved so no handle can be InvalidEntity
+        assert(nextEntity < EntityIndexMask && "Out of entity indices, raise ECS_ENTITY_INDEX_BITS");
+        return nextEntity++;
+    }
 
-        std::tuple<Cs*...> ptrs;
+    // Releases the index of a destroyed entity, every handle to it becomes stale
+    void FreeEntity(Entity index){
+        for(SparseSetBase* set : activeSparseSets){
+            set->RemoveIndex(index);
+        }
 
-        void SkipInvalid(){
-            auto& archetypes = view->world->archetypes;
+        locations[index] = { Invalid, 0 };
+        generations[index]++;
 
-            while(archIndex < archetypes.size()){
-                Archetype& arch = *archetypes[archIndex];
+        // Generations are exhausted, the index is never handed out again
+        if(generations[index] == EntityGenerationMask) return;
+        freeList.push_back(index);
+    }
 
-                if(arch.signature.Contains(view->required) && arch.Size() > 0){
-                    count = arch.Size();
-                    ptrs = std::tuple{
-                        arch.GetFast<Cs>()->data.data()...
-                    };
-                    return;
-                }
+    // Spawns count entities straight into the archetype of Cs..., every component is copy
+    // constructed from values. IDs come from the free list first, then fresh ones.
+    template<typename... Cs>
+    std::vector<Entity> CreateEntities(size_t count, const Cs&... values){
+        static_assert(sizeof...(Cs) > 0, "CreateEntities requires at least one component");
+        static_assert(!(IsSparse<Cs> || ...), "Sparse components are added with AddComponent");
 
-                ++archIndex;
-            }
+        std::vector<Entity> entities;
+        entities.reserve(count);
 
-            count = 0;
+        while(!freeList.empty() && entities.size() < count){
+            Entity index = freeList.back();
+            entities.push_back(MakeEntity(index, generations[index]));
+            freeList.pop_back();
         }
-
-        Iterator(View* v, size_t a, size_t i):view(v),archIndex(a),index(i),count(0){
-            SkipInvalid();
+        while(entities.size() < count){
+            entities.push_back(NewEntityIndex());
         }
+        locations.resize(nextEntity);
+        generations.resize(nextEntity);
+
+        Archetype* dst = GetOrCreateArchetype(Signature::Make<Cs...>());
+        ++structuralVersion;
+
+        size_t row = dst->Size();
+        dst->Reserve(row + count);
+        dst->count += count;
+
+        // Fill block by block so every column is written as one contiguous run
+        for(size_t done = 0; done < count;){
+            const size_t b = row >> dst->blockShift;
+            const size_t slot = row & dst->blockMask;
+            const size_t n = std::min(count - done, dst->blockRows - slot);
+
+            Entity* ids = dst->Entities(b) + slot;
+            for(size_t i = 0; i < n; ++i){
+                Entity e = entities[done + i];
+                ids[i] = e;
+                locations[EntityIndex(e)] = { (uint32_t)(row + i), dst->denseIndex };
+            }
 
-        inline auto operator*() const noexcept {
-            return std::apply(
-                [&](auto*... p) {
-                    return std::tuple<Cs&...>(p[index]...);
-                },
-                ptrs
-            );
-        }
+            (dst->Fill(row, n, values), ...);
 
-        Iterator& operator++(){
-            ++index;
-            if(index >= count){
-                ++archIndex;
-                index = 0;
-                SkipInvalid();
-            }
-            return *this;
+            row += n;
+            done += n;
         }
 
-        bool operator==(const Iterator& other) const {
-            return archIndex == other.archIndex && index == other.index;
-        }
+        return entities;
+    }
 
-        bool operator!=(const Iterator& other) const {
-            return !(*this == other);
+    void DestroyEntity(Entity e){
+        assert(EntityIndex(e) < locations.size());
+
+        // Entity already destroyed
+        if(!IsAlive(e)){
+            return;
         }
-    };
 
-    Iterator begin(){ return Iterator{ this, 0, 0 }; }
-    Iterator end(){ return Iterator{ this, world->archetypes.size(), 0 }; }
-};
+        EntityLocation& loc = locations[EntityIndex(e)];
 
-////////////////////////////////
+        // Remove row from archetype (swap-remove)
+        if(Archetype* arch = ArchetypeAt(loc)){
+            arch->Remove(loc.index, locations);
+            ++structuralVersion;
+        }
 
-template<typename... Ts>
-struct Exclude {};
+        FreeEntity(EntityIndex(e));
+    }
 
-template<typename... Ts>
-constexpr Exclude<Ts...> exclude{};
+    // Destroys a set of entities grouped by archetype, each archetype is compacted in one pass.
+    // Invalid, already destroyed and duplicated entities are ignored.
+    void DestroyEntities(const Entity* entities, size_t count){
+        ++structuralVersion;
 
-template<typename... Cs>
-struct ViewWithExclude{
-    World* world;
-    Signature include;
-    Signature exclude;
+        // Doomed rows per archetype as a bitmap, read back highest row first
+        struct Group{
+            Archetype* archetype;
+            std::pmr::vector<uint64_t> rows;
+        };
+        std::pmr::vector<Group> groups(resource);
 
-    template<typename... Es>
-    ViewWithExclude(World* w, Exclude<Es...>):world(w){
-        (include.set(GetComponentID<Cs>()), ...);
-        (exclude.set(GetComponentID<Es>()), ...);
-    }
+        // Batches usually come from a few archetypes, so groups are found by a linear scan
+        // behind a last-hit cache
+        size_t current = 0;
+        for(size_t i = 0; i < count; ++i){
+            Entity e = entities[i];
+            if(!IsAlive(e)) continue;
 
-    template<typename Func>
-    void Each(Func&& func){
-        for(auto& archPtr : world->archetypes){
-            Archetype& arch = *archPtr;
+            EntityLocation& loc = locations[EntityIndex(e)];
+            Archetype* arch = ArchetypeAt(loc);
+            if(!arch){
+                FreeEntity(EntityIndex(e));
+                continue;
+            }
 
-            if(!arch.signature.Contains(include)) continue;
-            if(arch.signature.Intersects(exclude)) continue;
+            if(groups.empty() || groups[current].archetype != arch){
+                current = 0;
+                while(current < groups.size() && groups[current].archetype != arch) ++current;
+                if(current == groups.size()){
+                    groups.push_back({ arch, std::pmr::vector<uint64_t>((arch->Size() + 63) / 64, resource) });
+                }
+            }
+            groups[current].rows[loc.index / 64] |= 1ull << (loc.index & 63);
+        }
 
-            auto arrays = std::tuple{ arch.Get<Cs>()... };
+        std::pmr::vector<uint32_t> rows(resource);
+        for(Group& g : groups){
+            rows.clear();
+            for(size_t w = g.rows.size(); w-- > 0;){
+                for(uint64_t bits = g.rows[w]; bits;){
+                    uint32_t bit = 63 - CountLeadingZeros64(bits);
+                    rows.push_back((uint32_t)(w * 64 + bit));
+                    bits &= ~(1ull << bit);
+                }
+            }
 
-            for(size_t i = 0; i < arch.Size(); ++i){
-                std::apply(
-                    [&](auto*... arr){
-                        func(arr->data[i]...);
-                    },
-                    arrays
-                );
+            for(uint32_t row : rows){
+                FreeEntity(EntityIndex(g.archetype->EntityAt(row)));
             }
+
+            g.archetype->RemoveRows(rows, locations);
         }
     }
 
-    template<typename Func>
-    void EachWithEntity(Func&& func){
-        for(auto& archPtr : world->archetypes){
+    void DestroyEntities(const std::vector<Entity>& entities){
+        DestroyEntities(entities.data(), entities.size());
+    }
+
+    // Destroys every entity whose archetype contains include and does not intersect exclude,
+    // whole archetypes are truncated at once
+    void DestroyMatching(const Signature& include, const Signature& exclude = {}){
+        ++structuralVersion;
+
+        for(auto& archPtr : CandidateArchetypes(include)){
             Archetype& arch = *archPtr;
 
             if(!arch.signature.Contains(include)) continue;
             if(arch.signature.Intersects(exclude)) continue;
 
-            auto arrays = std::tuple{ arch.Get<Cs>()... };
+            DestroyArchetypeEntities(arch);
+        }
+    }
 
-            for(size_t i = 0; i < arch.Size(); ++i){
-                Entity e = arch.entities[i];
-                std::apply(
-                    [&](auto*... arr){
-                        func(e, arr->data[i]...);
-                    },
-                    arrays
-                );
+    void DestroyArchetypeEntities(Archetype& arch){
+        for(size_t b = 0; b < arch.BlockCount(); ++b){
+            Entity* ids = arch.Entities(b);
+            for(size_t i = 0; i < arch.BlockSize(b); ++i){
+                FreeEntity(EntityIndex(ids[i]));
             }
         }
-    }
-};
 
-struct ComponentBatch{
-    struct Entry{
-        ComponentID id;
-        void* data;
-        void (*destroy)(void*);
-    };
+        arch.Clear();
+    }
 
-    Signature sig;
-    std::vector<Entry> entries;
+    template<typename... Cs>
+    void DestroyMatching(const View<Cs...>& view){
+        static_assert(!View<Cs...>::HasSparse, "Sparse components are not matched by signature");
+        ++structuralVersion;
 
-    template<typename T>
-    void Add(T&& value){
-        ComponentID id = GetComponentID<T>();
-        sig.set(id);
+        for(Archetype* arch : view.query->matched){
+            DestroyArchetypeEntities(*arch);
+        }
+    }
 
-        T* ptr = new T(std::forward<T>(value));
+    // The handle still refers to a live entity, a stale one fails the generation compare
+    inline bool IsAlive(Entity e){
+        Entity index = EntityIndex(e);
+        return index < generations.size() && generations[index] == GetEntityGeneration(e);
+    }
 
-        entries.push_back({
-            id,
-            ptr,
-            [](void* p) { delete static_cast<T*>(p); }
-        });
+    // Alive and holding at least one component
+    inline bool IsValid(Entity e){
+        if(e == InvalidEntity) return false;
+        return IsAlive(e) && locations[EntityIndex(e)].archetype != 0;
     }
 
-    void Clear(){
-        for(auto& e : entries){
-            e.destroy(e.data);
-        }
+    Archetype* ArchetypeAt(const EntityLocation& loc) const {
+        return archetypeByIndex[loc.archetype];
+    }
 
-        entries.clear();
-        sig = {};
+    // Archetype holding e, nullptr when it has no component
+    Archetype* ArchetypeOf(Entity e){
+        return ArchetypeAt(locations[EntityIndex(e)]);
     }
-};
 
-struct World {
-    Entity nextEntity = 0;
-    std::vector<EntityLocation> locations;
-    std::vector<std::unique_ptr<Archetype>> archetypes;
-    std::vector<Entity> freeList;
+    struct CompactStats {
+        size_t archetypesFreed = 0;
+        size_t bytesReclaimed = 0;
+    };
 
-    Entity CreateEntity(){
-        if(!freeList.empty()){
-            Entity e = freeList.back();
-            freeList.pop_back();
-            locations[e] = {};
-            return e;
+    // Frees every empty archetype and, when shrink is set, trims the spare capacity of the others.
+    // Cached views notice the new epoch and match again from scratch.
+    CompactStats Compact(bool shrink = true){
+        CompactStats stats;
+        ++structuralVersion;
+
+        // Edges into archetypes about to be freed are forgotten, they are rebuilt on demand
+        auto dropEmptyEdges = [](std::pmr::vector<ArchetypeEdge>& edges){
+            for(auto& edge : edges){
+                if(edge.add && edge.add->Size() == 0) edge.add = nullptr;
+                if(edge.remove && edge.remove->Size() == 0) edge.remove = nullptr;
+            }
+        };
+
+        dropEmptyEdges(rootEdges);
+        for(auto& a : archetypes){
+            if(a->Size() == 0){
+                stats.archetypesFreed++;
+                stats.bytesReclaimed += a->ReservedBytes() + sizeof(Archetype);
+                continue;
+            }
+
+            dropEmptyEdges(a->edges);
+            if(shrink) stats.bytesReclaimed += a->ShrinkToFit();
         }
-        
-        Entity e = nextEntity++;
-        locations.resize(e+1);
-        locations[e] = {};
-        return e;
-    }
 
-    void DestroyEntity(Entity e){
-        assert(e < locations.size());
+        if(stats.archetypesFreed == 0) return stats;
+
+        archetypes.erase(
+            std::remove_if(archetypes.begin(), archetypes.end(), [](const ArchetypePtr& a){ return a->Size() == 0; }),
+            archetypes.end()
+        );
+
+        // Survivors are renumbered densely, locations of entities whose archetype moved are patched
+        archetypeByIndex.resize(1);
+        for(auto& list : componentArchetypes) list.clear();
+        for(auto& a : archetypes){
+            IndexArchetype(a.get());
 
-        EntityLocation& loc = locations[e];
+            const uint32_t index = (uint32_t)archetypeByIndex.size();
+            archetypeByIndex.push_back(a.get());
+            if(a->denseIndex == index) continue;
 
-        // Entity already destroyed or never had components
-        if(loc.archetype == nullptr){
-            return;
+            a->denseIndex = index;
+            for(size_t b = 0; b < a->BlockCount(); ++b){
+                Entity* ids = a->Entities(b);
+                for(size_t i = 0; i < a->BlockSize(b); ++i){
+                    locations[EntityIndex(ids[i])].archetype = index;
+                }
+            }
         }
 
-        Archetype* arch = loc.archetype;
+        size_t cap = 64;
+        while(archetypes.size() * 10 >= cap * 7) cap <<= 1;
+        InitArchetypeTable(cap);
+        for(auto& a : archetypes){
+            size_t h = a->signature.Hash() & archetypeMask;
+            while(archetypeTable[h].archetype){
+                h = (h + 1) & archetypeMask;
+            }
 
-        // Remove row from archetype (swap-remove)
-        arch->Remove(loc.index, locations);
+            archetypeTable[h] = { a->signature, a.get() };
+            archetypeCount++;
+        }
 
-        // Invalidate entity location
-        loc.archetype = nullptr;
-        loc.index = Invalid;
-        freeList.push_back(e);
+        for(auto& [key, q] : queries) MatchQuery(q);
+        return stats;
     }
 
-    inline bool IsValid(Entity e){
-        if(e == InvalidEntity) return false;
-        if(e >= locations.size()) return false;
-        return locations[e].archetype != nullptr;
+    // Automatic policy: when a new archetype would push the count past the limit, empty
+    // archetypes are freed first. Storage is not shrunk, 0 disables it.
+    size_t autoCompactArchetypes = 0;
+    size_t nextAutoCompact = 0;
+
+    void SetAutoCompact(size_t maxArchetypes){
+        autoCompactArchetypes = maxArchetypes;
+        nextAutoCompact = maxArchetypes;
     }
 
     //////////////////
@@ -1114,10 +2433,13 @@ struct World {
         Archetype* archetype = nullptr;
     };
 
-    std::vector<ArchetypeSlot> archetypeTable;
+    std::pmr::vector<ArchetypeSlot> archetypeTable{resource};
     size_t archetypeMask = 0;
     size_t archetypeCount = 0;
 
+    // Edges taken by entities that have no archetype yet
+    std::pmr::vector<ArchetypeEdge> rootEdges{resource};
+
     void InitArchetypeTable(size_t initialCapacity = 64){
         // must be power of two
         size_t cap = 1;
@@ -1130,7 +2452,7 @@ struct World {
     }
 
     void RehashArchetypes(size_t newCapacity) {
-        std::vector<ArchetypeSlot> old = std::move(archetypeTable);
+        std::pmr::vector<ArchetypeSlot> old = std::move(archetypeTable);
 
         InitArchetypeTable(newCapacity);
 
@@ -1147,6 +2469,89 @@ struct World {
         }
     }
 
+    ArchetypePtr NewArchetype(const Signature& sig){
+        void* mem = resource->allocate(sizeof(Archetype), alignof(Archetype));
+        ArchetypePtr a(new(mem) Archetype(sig, layout, resource), ArchetypeDeleter{ resource });
+
+        a->denseIndex = (uint32_t)archetypeByIndex.size();
+        archetypeByIndex.push_back(a.get());
+        IndexArchetype(a.get());
+
+        for(auto& [key, q] : queries){
+            if(q.Matches(sig)){
+                q.matched.push_back(a.get());
+                q.version++;
+            }
+        }
+        return a;
+    }
+
+    void IndexArchetype(Archetype* a){
+        for(ComponentID id : a->componentIDs){
+            if(id >= componentArchetypes.size()) componentArchetypes.resize(id + 1);
+            componentArchetypes[id].push_back(a);
+        }
+    }
+
+    Query* GetQuery(const Signature& include, const Signature& exclude, const std::pmr::vector<Signature>& anyOf = {}){
+        QueryKey key{ include, exclude, std::pmr::vector<Signature>(anyOf, resource) };
+        auto [it, inserted] = queries.try_emplace(std::move(key), resource);
+        if(inserted){
+            it->second.include = include;
+            it->second.exclude = exclude;
+            it->second.anyOf.assign(anyOf.begin(), anyOf.end());
+            MatchQuery(it->second);
+        }
+        return &it->second;
+    }
+
+    // Rebuilds the match list from the inverted index. Runs when a query is registered and
+    // after Compact, new archetypes are appended to every query as they are created.
+    void MatchQuery(Query& q){
+        q.matched.clear();
+        for(Archetype* a : CandidateArchetypes(q.include)){
+            if(q.Matches(a->signature)) q.matched.push_back(a);
+        }
+        q.version++;
+    }
+
+    // Calls fn on each archetype containing required. Reads the registered query when there
+    // is one and never registers, so iterating does not touch shared state.
+    template<typename Fn>
+    void ForEachMatching(const Signature& required, Fn&& fn){
+        QueryKey key{ required, Signature{}, std::pmr::vector<Signature>(resource) };
+        auto it = queries.find(key);
+        if(it != queries.end()){
+            for(Archetype* a : it->second.matched) fn(*a);
+            return;
+        }
+
+        for(Archetype* a : CandidateArchetypes(required)){
+            if(a->signature.Contains(required)) fn(*a);
+        }
+    }
+
+    // The archetypes a query on include has to test: those of its rarest component, or all of
+    // them when include is empty. Callers still check the whole signature, which intersects the
+    // other components, so matching cost follows the candidates instead of the archetype count.
+    ArchetypeRange CandidateArchetypes(const Signature& include) const {
+        const std::pmr::vector<Archetype*>* rarest = nullptr;
+
+        for(uint64_t m = include.summary; m; m &= m - 1){
+            const size_t w = CountTrailingZeros64(m);
+            for(uint64_t bits = include.bits[w]; bits; bits &= bits - 1){
+                const ComponentID id = (ComponentID)(w * ChunkBits + CountTrailingZeros64(bits));
+                if(id >= componentArchetypes.size()) return {};
+
+                const auto& list = componentArchetypes[id];
+                if(!rarest || list.size() < rarest->size()) rarest = &list;
+            }
+        }
+
+        if(!rarest) return { archetypeByIndex.data() + 1, archetypeByIndex.data() + archetypeByIndex.size() };
+        return { rarest->data(), rarest->data() + rarest->size() };
+    }
+
     //INFO: Not full tested yet
     Archetype* GetOrCreateArchetype(const Signature& sig){
         // Lazy init
@@ -1154,6 +2559,12 @@ struct World {
             InitArchetypeTable(64);
         }
 
+        // Callers only hold non empty archetypes here, so freeing the empty ones is safe
+        if(autoCompactArchetypes && archetypes.size() >= nextAutoCompact){
+            Compact(false);
+            nextAutoCompact = std::max(autoCompactArchetypes, archetypes.size() * 2);
+        }
+
         // Resize if load factor > 70%
         if((archetypeCount + 1) * 10 >= archetypeTable.size() * 7){
             RehashArchetypes(archetypeTable.size() * 2);
@@ -1166,7 +2577,7 @@ struct World {
 
             if(!slot.archetype){
                 // Create new archetype
-                archetypes.push_back(std::make_unique<Archetype>(sig));
+                archetypes.push_back(NewArchetype(sig));
 
                 slot.sig = sig;
                 slot.archetype = archetypes.back().get();
@@ -1190,7 +2601,7 @@ struct World {
             if(a->signature == signature) return a.get();
         }
 
-        archetypes.push_back(std::make_unique<Archetype>(signature));
+        archetypes.push_back(NewArchetype(signature));
         return archetypes.back().get();
     }
 
@@ -1202,80 +2613,109 @@ struct World {
             [](auto& a, auto& b){ return a.id < b.id; }
         );*/
 
-        EntityLocation& loc = locations[e];
+        assert(IsAlive(e) && "Stale entity");
+        EntityLocation& loc = locations[EntityIndex(e)];
+
+        Archetype* src = ArchetypeAt(loc);
 
         Signature oldSig;
-        if(loc.archetype) oldSig = loc.archetype->signature;
+        if(src) oldSig = src->signature;
 
+        // batch.sig also carries the tags, which have no entry
         Signature newSig = oldSig;
-        for(auto& ent : batch.entries){
-            newSig.set(ent.id);
-        }
+        newSig.Merge(batch.sig);
 
         Archetype* dst = GetOrCreateArchetype(newSig);
-        uint32_t newRow = dst->Size();
+        uint32_t newRow = dst->PushEntity(e);
 
-        if(loc.archetype){
-            loc.archetype->CopyRowTo(*dst, loc.index);
-            loc.archetype->Remove(loc.index, locations);
+        if(src){
+            src->MoveRowTo(*dst, loc.index, newRow, locations);
         }
 
         for(auto& ent : batch.entries){
-            uint16_t idx = dst->mapToComponents[ent.id];
+            uint16_t idx = dst->ColumnIndex(ent.id);
             assert(idx != Invalid);
-            assert(dst->components[idx]->GetID() == ent.id && "Invalid component cast");
+            assert(dst->columns[idx].info->id == ent.id && "Invalid component cast");
 
-            dst->components[idx]->EmplaceFromRaw(ent.data);
+            ComponentColumn& c = dst->columns[idx];
+            dst->EmplaceElement(c, newRow, batch.Data(ent));
         }
 
-        dst->entities.push_back(e);
-        loc = { newRow, dst };
+        loc = { newRow, dst->denseIndex };
+        ++structuralVersion;
 
         batch.Clear();
     }
 
     template<typename T>
-    void AddComponent(Entity e, T value = {}){
-        ComponentID id = GetComponentID<T>();
-        EntityLocation& loc = locations[e];
+    SparseSet<T>& GetSparseSet(){
+        const ComponentID id = GetComponentID<T>();
+        if(id >= sparseSets.size()) sparseSets.resize(id + 1);
+
+        if(!sparseSets[id]){
+            void* mem = resource->allocate(sizeof(SparseSet<T>), alignof(SparseSet<T>));
+            SparseSet<T>* set = new(mem) SparseSet<T>(resource);
+            set->objectSize = sizeof(SparseSet<T>);
+            set->objectAlign = alignof(SparseSet<T>);
+
+            sparseSets[id] = SparseSetPtr(set, SparseSetDeleter{ resource });
+            activeSparseSets.push_back(set);
+        }
+        return *static_cast<SparseSet<T>*>(sparseSets[id].get());
+    }
 
-        Signature oldSig;
-        if(loc.archetype != nullptr){
-            oldSig = loc.archetype->signature;
-            if(oldSig.test(id)){
+    template<typename T>
+    void AddComponent(Entity e, T value = {}){
+        assert(IsAlive(e) && "Stale entity");
+        if constexpr (IsSparse<T>){
+            GetSparseSet<T>().Emplace(e, std::move(value));
+        } else {
+            ComponentID id = GetComponentID<T>();
+            EntityLocation& loc = locations[EntityIndex(e)];
+
+            Archetype* src = ArchetypeAt(loc);
+            if(src != nullptr && src->Has(id)){
                 assert(false && "Already Contain Comp!!");
                 return;
             }
-        }
 
-        Signature newSig = oldSig;
-        newSig.set(id);
+            ArchetypeEdge& edge = FindEdge(src ? src->edges : rootEdges, id);
+            if(!edge.add){
+                Signature newSig;
+                if(src) newSig = src->signature;
+                newSig.set(id);
 
-        Archetype* dst = GetOrCreateArchetype(newSig);
+                edge.add = GetOrCreateArchetype(newSig);
+                if(src) FindEdge(edge.add->edges, id).remove = src;
+            }
+            Archetype* dst = edge.add;
 
-        uint32_t newRow = dst->Size();
+            uint32_t newRow = dst->PushEntity(e);
 
-        if(loc.archetype != nullptr){
-            loc.archetype->CopyRowTo(*dst, loc.index);
-            //loc.archetype->Remove(loc.index);
-            loc.archetype->Remove(loc.index, locations);
-        }
+            if(src != nullptr){
+                src->MoveRowTo(*dst, loc.index, newRow, locations);
+            }
 
-        dst->Get<T>()->data.push_back(value);
-        dst->entities.push_back(e);
+            dst->Construct<T>(newRow, std::move(value));
 
-        loc = { newRow, dst };
+            loc = { newRow, dst->denseIndex };
+            ++structuralVersion;
+        }
     }
 
     template<typename... Ts>
     void AddMultComponent(Entity e, Ts&&... values){
         static_assert(sizeof...(Ts) > 0, "AddComponent requires at least one component");
+        static_assert(!(IsSparse<std::decay_t<Ts>> || ...), "Sparse components are added with AddComponent");
 
-        EntityLocation& loc = locations[e];
+        assert(IsAlive(e) && "Stale entity");
+        EntityLocation& loc = locations[EntityIndex(e)];
+
+        Archetype* src = ArchetypeAt(loc);
 
         Signature oldSig;
-        if(loc.archetype){
-            oldSig = loc.archetype->signature;
+        if(src){
+            oldSig = src->signature;
 
             bool alreadyHas = (oldSig.test(GetComponentID<std::decay_t<Ts>>()) || ...);
             assert(!alreadyHas && "Entity already has one of the components");
@@ -1284,72 +2724,134 @@ struct World {
         Signature newSig = Signature::MakeWith<std::decay_t<Ts>...>(oldSig);
 
         Archetype* dst = GetOrCreateArchetype(newSig);
-        uint32_t newRow = dst->Size();
+        uint32_t newRow = dst->PushEntity(e);
 
-        if(loc.archetype){
-            loc.archetype->CopyRowTo(*dst, loc.index);
-            loc.archetype->Remove(loc.index, locations);
+        if(src){
+            src->MoveRowTo(*dst, loc.index, newRow, locations);
         }
 
         (
-            dst->Get<std::decay_t<Ts>>()->data.emplace_back(
+            dst->Construct<std::decay_t<Ts>>(
+                newRow,
                 std::forward<Ts>(values)
             ),
             ...
         );
 
-        dst->entities.push_back(e);
-        loc = { newRow, dst };
+        loc = { newRow, dst->denseIndex };
+        ++structuralVersion;
     }
 
     template<typename T>
     void RemoveComponent(Entity e) {
-        EntityLocation& loc = locations[e];
-        Archetype* src = loc.archetype;
-        assert(src && "Entity has no components");
+        assert(IsAlive(e) && "Stale entity");
+        if constexpr (IsSparse<T>){
+            assert(GetSparseSet<T>().Has(e) && "Entity does not have component");
+            GetSparseSet<T>().RemoveIndex(EntityIndex(e));
+        } else {
+            EntityLocation& loc = locations[EntityIndex(e)];
+            Archetype* src = ArchetypeAt(loc);
+            assert(src && "Entity has no components");
+
+            ComponentID id = GetComponentID<T>();
+            assert(src->Has(id) && "Entity does not have component");
+
+            ArchetypeEdge& edge = FindEdge(src->edges, id);
+            if(!edge.remove){
+                Signature newSig = src->signature;
+                newSig.reset(id);
+
+                edge.remove = GetOrCreateArchetype(newSig);
+                FindEdge(edge.remove->edges, id).add = src;
+            }
+            Archetype* dst = edge.remove;
 
-        ComponentID id = GetComponentID<T>();
-        assert(src->Has(id) && "Entity does not have component");
+            // Add entity to destination
+            uint32_t newRow = dst->PushEntity(e);
 
-        Signature oldSig = src->signature;
-        Signature newSig = oldSig;
-        newSig.bits[id / 64] &= ~(1ull << (id & 63));
+            // Move all components except T, T is destroyed in place
+            src->MoveRowTo(*dst, loc.index, newRow, locations);
 
-        Archetype* dst = GetOrCreateArchetype(newSig);
-        uint32_t newRow = dst->Size();
+            // Update entity location
+            loc = { newRow, dst->denseIndex };
+            ++structuralVersion;
+        }
+    }
+
+    // A disabled entity keeps its row and components but is skipped by View::Each, the cached
+    // views, the iterators and World::Each. Flipping it is a bit write, the entity does not change archetype.
+    void SetEnabled(Entity e, bool enabled){
+        assert(IsAlive(e) && "Stale entity");
+        EntityLocation& loc = locations[EntityIndex(e)];
+        Archetype* arch = ArchetypeAt(loc);
+        assert(arch && "Entity has no components");
 
-        // Copy all components except T
-        src->CopyRowTo(*dst, loc.index);
+        arch->SetDisabled(0, loc.index, !enabled);
+    }
 
-        // Add entity to destination
-        dst->entities.push_back(e);
+    bool IsEnabled(Entity e){
+        assert(IsAlive(e) && "Stale entity");
+        EntityLocation& loc = locations[EntityIndex(e)];
+        Archetype* arch = ArchetypeAt(loc);
+        return !arch || !arch->IsDisabled(0, loc.index);
+    }
 
-        // Remove from source archetype
-        src->Remove(loc.index, locations);
+    // Hides only T of e from views that read T, views without T still see the entity.
+    // Does nothing when e has no T.
+    template<typename T>
+    void SetComponentEnabled(Entity e, bool enabled){
+        static_assert(!IsSparse<T> && !std::is_empty_v<T>, "Only components stored in a column can be disabled");
+        assert(IsAlive(e) && "Stale entity");
+        EntityLocation& loc = locations[EntityIndex(e)];
+        Archetype* arch = ArchetypeAt(loc);
+        if(!arch) return;
 
-        // Update entity location
-        loc = { newRow, dst };
+        const uint16_t c = arch->ColumnIndex(GetComponentID<T>());
+        if(c == Invalid) return;
+        arch->SetDisabled(1 + c, loc.index, !enabled);
     }
 
+    // False when e has no T
     template<typename T>
-    bool HasComponent(Entity e){
-        EntityLocation& loc = locations[e];
-        Archetype* arch = loc.archetype;
+    bool IsComponentEnabled(Entity e){
+        static_assert(!IsSparse<T> && !std::is_empty_v<T>, "Only components stored in a column can be disabled");
+        assert(IsAlive(e) && "Stale entity");
+        EntityLocation& loc = locations[EntityIndex(e)];
+        Archetype* arch = ArchetypeAt(loc);
+        if(!arch) return false;
 
-        uint16_t compIndex = arch->mapToComponents[GetComponentID<T>()];
-        return compIndex != Invalid;
+        const uint16_t c = arch->ColumnIndex(GetComponentID<T>());
+        return c != Invalid && !arch->IsDisabled(1 + c, loc.index);
+    }
+
+    template<typename T>
+    bool HasComponent(Entity e){
+        assert(IsAlive(e) && "Stale entity");
+        if constexpr (IsSparse<T>){
+            const ComponentID id = GetComponentID<T>();
+            return id < sparseSets.size() && sparseSets[id] && sparseSets[id]->Has(e);
+        } else {
+            EntityLocation& loc = locations[EntityIndex(e)];
+            Archetype* arch = ArchetypeAt(loc);
+
+            return arch && arch->Has(GetComponentID<T>());
+        }
     }
 
+    // T& for regular components, an SoARef<T> for SoA ones
     template<typename T>
-    T& GetComponent(Entity e){
-        EntityLocation& loc = locations[e];
-        Archetype* arch = loc.archetype;
+    decltype(auto) GetComponent(Entity e){
+        assert(IsAlive(e) && "Stale entity");
+        if constexpr (IsSparse<T>){
+            return GetSparseSet<T>().Get(e);
+        } else {
+            EntityLocation& loc = locations[EntityIndex(e)];
+            Archetype* arch = ArchetypeAt(loc);
 
-        uint16_t compIndex = arch->mapToComponents[GetComponentID<T>()];
-        assert(compIndex != Invalid);
+            assert(arch->Has(GetComponentID<T>()));
 
-        auto* array = arch->GetFast<T>();
-        return array->data[loc.index];
+            return arch->Ref<T>(loc.index);
+        }
     }
 
     template<typename... Cs>
@@ -1361,51 +2863,32 @@ struct World {
 
     template<typename... Cs, typename Func>
     void Each(Func&& func){
+        static_assert(!(IsSparse<Cs> || ...), "Sparse components are not matched by signature, use GetView");
+
         Signature required;
         (required.set(GetComponentID<Cs>()), ...);
 
-        for(auto& archPtr : archetypes){
-            Archetype& arch = *archPtr;
-
-            //if(((arch.signature & required) != required)) continue;
-            if(!arch.signature.Contains(required)) continue;
-
-            auto arrays = std::tuple{ arch.Get<Cs>()... };
-
-            for(size_t i = 0; i < arch.Size(); ++i){
-                std::apply(
-                    [&](auto*... arr){
-                        func(arr->data[i]...);
-                    }, 
-                    arrays
-                );
+        ForEachMatching(required, [&](Archetype& arch){
+            const std::array<uint16_t, 1 + sizeof...(Cs)> masks = { 0, ViewTerm<Cs>::Mask(arch)... };
+            for(size_t b = 0; b < arch.BlockCount(); ++b){
+                ForEachEnabled(arch, masks, b << arch.blockShift, 0, arch.BlockSize(b), func, arch.Column<Cs>(b)...);
             }
-        }
+        });
     }
 
     template<typename... Cs, typename Func>
     void EachWithEntity(Func&& func){
+        static_assert(!(IsSparse<Cs> || ...), "Sparse components are not matched by signature, use GetView");
+
         Signature required;
         (required.set(GetComponentID<Cs>()), ...);
 
-        for(auto& archPtr : archetypes){
-            Archetype& arch = *archPtr;
-
-            //if(((arch.signature & required) != required)) continue;
-            if(!arch.signature.Contains(required)) continue;
-
-            auto arrays = std::tuple{ arch.Get<Cs>()... };
-
-            for(size_t i = 0; i < arch.Size(); ++i){
-                Entity e = arch.entities[i];
-                std::apply(
-                    [&](auto*... arr){
-                        func(e, arr->data[i]...);
-                    }, 
-                    arrays
-                );
+        ForEachMatching(required, [&](Archetype& arch){
+            const std::array<uint16_t, 1 + sizeof...(Cs)> masks = { 0, ViewTerm<Cs>::Mask(arch)... };
+            for(size_t b = 0; b < arch.BlockCount(); ++b){
+                ForEachEnabled(arch, masks, b << arch.blockShift, 0, arch.BlockSize(b), func, arch.Entities(b), arch.Column<Cs>(b)...);
             }
-        }
+        });
     }
 
     template<typename... Cs>
@@ -1413,11 +2896,45 @@ struct World {
         return View<Cs...>(this);
     }
 
+    template<typename... Cs, typename... Es>
+    auto GetView(Exclude<Es...>){
+        return View<Cs...>(this, Exclude<Es...>{});
+    }
+
     template<typename... Cs, typename... Es>
     auto GetViewWithExclude(Exclude<Es...>) {
-        return ViewWithExclude<Cs...>{ this, Exclude<Es...>{} };
+        return View<Cs...>(this, Exclude<Es...>{});
     }
 
 };
 
+inline std::pmr::memory_resource* WorldResource(World* world){
+    return world->resource;
+}
+
+////////////////////////////////
+
+// Bundled per-world arena. Allocations up to BlockBytes, which covers every Chunked block, are
+// pooled by size and recycled; the pooled memory is only returned when the arena is destroyed.
+// Larger ones (Contiguous buffers past one block) go straight to upstream and are freed with
+// their archetype, so despawned storage is reused instead of piling up.
+// Not thread safe: use one arena per world.
+struct WorldArena {
+    std::pmr::unsynchronized_pool_resource pool;
+
+    explicit WorldArena(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        :pool(PoolOptions(), upstream){}
+
+    WorldArena(const WorldArena&) = delete;
+    WorldArena& operator=(const WorldArena&) = delete;
+
+    std::pmr::memory_resource* Resource(){ return &pool; }
+
+    static std::pmr::pool_options PoolOptions(){
+        std::pmr::pool_options options;
+        options.largest_required_pool_block = BlockBytes;
+        return options;
+    }
+};
+
 }
\ No newline at end of file
@@ -4,10 +4,10 @@ TEST_F(ECSTest, AddComponent_MovesEntityBetweenArchetypes) {
     Entity e = world.CreateEntity();
 
     world.AddComponent<Position>(e);
-    auto* arch1 = world.locations[e].archetype;
+    auto* arch1 = world.ArchetypeOf(e);
 
     world.AddComponent<Velocity>(e);
-    auto* arch2 = world.locations[e].archetype;
+    auto* arch2 = world.ArchetypeOf(e);
 
     ASSERT_NE(arch1, arch2);
     ASSERT_TRUE(world.HasComponent<Position>(e));
@@ -19,11 +19,167 @@ TEST_F(ECSTest, RemoveComponent_MovesEntityBack) {
 
     world.AddComponent<Position>(e);
     world.AddComponent<Velocity>(e);
-    auto* arch2 = world.locations[e].archetype;
+    auto* arch2 = world.ArchetypeOf(e);
 
     world.RemoveComponent<Velocity>(e);
-    auto* arch1 = world.locations[e].archetype;
+    auto* arch1 = world.ArchetypeOf(e);
 
     ASSERT_NE(arch1, arch2);
     ASSERT_TRUE(world.HasComponent<Position>(e));
 }
+
+TEST_F(ECSTest, Archetype_ColumnLookupOnlyCoversItsComponents) {
+    Entity e = world.CreateEntity();
+    world.AddComponent<Position>(e);
+    world.AddComponent<Health>(e);
+    world.AddComponent<Disabled>(e);
+
+    Archetype* arch = world.ArchetypeOf(e);
+    ASSERT_EQ(arch->columns.size(), 3u);
+    ASSERT_LE(arch->columnSlots.size(), 8u);
+
+    for(ComponentID id : { GetComponentID<Position>(), GetComponentID<Health>(), GetComponentID<Disabled>() }){
+        uint16_t column = arch->ColumnIndex(id);
+        ASSERT_NE(column, Invalid);
+        ASSERT_EQ(arch->columns[column].info->id, id);
+    }
+
+    ASSERT_EQ(arch->ColumnIndex(GetComponentID<Velocity>()), Invalid);
+    ASSERT_FALSE(arch->Has(GetComponentID<Velocity>()));
+}
+
+TEST_F(ECSTest, Archetype_TransitionsAreCachedAsEdges) {
+    Entity a = world.CreateEntity();
+    world.AddComponent<Position>(a);
+    Archetype* pos = world.ArchetypeOf(a);
+
+    world.AddComponent<Velocity>(a);
+    Archetype* posVel = world.ArchetypeOf(a);
+
+    ArchetypeEdge& edge = FindEdge(pos->edges, GetComponentID<Velocity>());
+    ASSERT_EQ(edge.add, posVel);
+    ASSERT_EQ(FindEdge(posVel->edges, GetComponentID<Velocity>()).remove, pos);
+
+    Entity b = world.CreateEntity();
+    world.AddComponent<Position>(b);
+    world.AddComponent<Velocity>(b);
+    ASSERT_EQ(world.ArchetypeOf(b), posVel);
+
+    world.RemoveComponent<Velocity>(b);
+    ASSERT_EQ(world.ArchetypeOf(b), pos);
+    ASSERT_EQ(world.archetypes.size(), 2u);
+}
+
+TEST_F(ECSTest, Compact_FreesEmptyArchetypes) {
+    Entity a = world.CreateEntity();
+    world.AddComponent<Position>(a);
+    Archetype* pos = world.ArchetypeOf(a);
+
+    std::vector<Entity> moved;
+    for(int i = 0; i < 1000; ++i){
+        Entity e = world.CreateEntity();
+        world.AddComponent<Position>(e, {(float)i, 0.f});
+        world.AddComponent<Velocity>(e);
+        world.AddComponent<Health>(e, {i});
+        moved.push_back(e);
+    }
+    for(int i = 0; i < 1000; ++i){
+        world.RemoveComponent<Velocity>(moved[i]);
+    }
+    ASSERT_EQ(world.archetypes.size(), 4u);
+
+    World::CompactStats stats = world.Compact();
+    ASSERT_EQ(stats.archetypesFreed, 2u);
+    ASSERT_GT(stats.bytesReclaimed, 0u);
+    ASSERT_EQ(world.archetypes.size(), 2u);
+    ASSERT_EQ(world.ArchetypeOf(a), pos);
+
+    for(int i = 0; i < 1000; ++i){
+        ASSERT_FLOAT_EQ(world.GetComponent<Position>(moved[i]).x, (float)i);
+        ASSERT_EQ(world.GetComponent<Health>(moved[i]).value, i);
+    }
+
+    // Lookups and edges recreate what was freed
+    world.AddComponent<Velocity>(a);
+    ASSERT_EQ(world.archetypes.size(), 3u);
+    ASSERT_EQ(world.GetOrCreateArchetype(Signature::Make<Position, Health>()), world.ArchetypeOf(moved[0]));
+    world.RemoveComponent<Velocity>(a);
+    ASSERT_EQ(world.ArchetypeOf(a), pos);
+
+    size_t visited = 0;
+    world.GetView<Position>().Each([&](Position&){ ++visited; });
+    ASSERT_EQ(visited, 1001u);
+}
+
+TEST_F(ECSTest, Compact_AutomaticPolicy) {
+    world.SetAutoCompact(4);
+
+    Entity e = world.CreateEntity();
+    world.AddComponent<Position>(e);
+
+    // Walks through all 8 archetypes with Position, leaving each one empty behind
+    for(int i = 0; i < 16; ++i){
+        if(i & 1) world.AddComponent<Velocity>(e); else if(i) world.RemoveComponent<Velocity>(e);
+        if(i % 4 == 2) world.AddComponent<Health>(e, {i}); else if(i % 4 == 0 && i) world.RemoveComponent<Health>(e);
+        if(i % 8 == 4) world.AddComponent<Disabled>(e); else if(i % 8 == 0 && i) world.RemoveComponent<Disabled>(e);
+
+        ASSERT_LE(world.archetypes.size(), 5u);
+        ASSERT_TRUE(world.HasComponent<Position>(e));
+    }
+}
+
+TEST_F(ECSTest, Compact_RenumbersEntityLocations) {
+    Entity a = world.CreateEntity();
+    world.AddComponent<Velocity>(a);
+    world.RemoveComponent<Velocity>(a);
+
+    std::vector<Entity> spawned = world.CreateEntities(100, Position{1.f, 2.f}, Health{3});
+    Archetype* arch = world.ArchetypeOf(spawned[0]);
+    ASSERT_EQ(world.archetypeByIndex[arch->denseIndex], arch);
+
+    world.DestroyEntity(a);
+    world.Compact();
+
+    ASSERT_EQ(world.archetypes.size(), 1u);
+    ASSERT_EQ(arch->denseIndex, 1u);
+    for(Entity e : spawned){
+        ASSERT_EQ(world.ArchetypeOf(e), arch);
+        ASSERT_EQ(world.GetComponent<Health>(e).value, 3);
+    }
+}
+
+TEST_F(ECSTest, ComponentIndex_QueriesStartFromRarestComponent) {
+    // Position lives in several archetypes, Health only in one of them
+    Entity a = world.CreateEntity();
+    world.AddComponent<Position>(a);
+    Entity b = world.CreateEntity();
+    world.AddMultComponent(b, Position{}, Velocity{});
+    Entity c = world.CreateEntity();
+    world.AddMultComponent(c, Position{}, Renderable{});
+    Entity d = world.CreateEntity();
+    world.AddMultComponent(d, Position{}, Health{});
+
+    ASSERT_EQ(world.componentArchetypes[GetComponentID<Position>()].size(), 4u);
+    ASSERT_EQ(world.CandidateArchetypes(Signature::Make<Position, Health>()).size(), 1u);
+    ASSERT_EQ(world.CandidateArchetypes(Signature::Make<Position>()).size(), 4u);
+    ASSERT_EQ(world.CandidateArchetypes(Signature{}).size(), world.archetypes.size());
+    ASSERT_EQ(world.CandidateArchetypes(Signature::Make<Disabled>()).size(), 0u);
+
+    int visited = 0;
+    for(auto [p, h] : world.GetView<Position, Health>()){
+        (void)p;
+        ASSERT_EQ(h.value, 100);
+        ++visited;
+    }
+    ASSERT_EQ(visited, 1);
+
+    // Compact keeps the index in step with the surviving archetypes
+    world.DestroyEntity(b);
+    world.Compact();
+    ASSERT_EQ(world.componentArchetypes[GetComponentID<Position>()].size(), 3u);
+    ASSERT_EQ(world.componentArchetypes[GetComponentID<Velocity>()].size(), 0u);
+
+    int positions = 0;
+    world.GetView<Position>().Each([&](Position&){ ++positions; });
+    ASSERT_EQ(positions, 3);
+}
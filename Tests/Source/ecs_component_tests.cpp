@@ -29,3 +29,213 @@ TEST_F(ECSTest, RemoveComponent) {
     ASSERT_TRUE(world.HasComponent<Position>(e));
     ASSERT_FALSE(world.HasComponent<Velocity>(e));
 }
+
+struct Name {
+    std::string value;
+};
+
+// Counts how often the value is duplicated
+struct CopyCounter {
+    static inline int copies = 0;
+    std::vector<int> data;
+
+    CopyCounter() = default;
+    CopyCounter(const CopyCounter& o):data(o.data){ ++copies; }
+    CopyCounter(CopyCounter&&) = default;
+    CopyCounter& operator=(const CopyCounter& o){ data = o.data; ++copies; return *this; }
+    CopyCounter& operator=(CopyCounter&&) = default;
+};
+
+TEST_F(ECSTest, RegisterComponent_FillsComponentInfo) {
+    RegisterComponent<Name>();
+
+    const ComponentInfo& pos = ComponentInfos()[GetComponentID<Position>()];
+    ASSERT_EQ(pos.size, sizeof(Position));
+    ASSERT_EQ(pos.align, alignof(Position));
+    ASSERT_TRUE(pos.triviallyRelocatable);
+
+    const ComponentInfo& name = ComponentInfos()[GetComponentID<Name>()];
+    ASSERT_EQ(name.size, sizeof(Name));
+    ASSERT_FALSE(name.triviallyRelocatable);
+}
+
+TEST_F(ECSTest, NonTrivialComponent_SurvivesMigrations) {
+    RegisterComponent<Name>();
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 100; ++i){
+        Entity e = world.CreateEntity();
+        world.AddComponent<Name>(e, {"entity with a name long enough to allocate " + std::to_string(i)});
+        world.AddComponent<Position>(e);
+        entities.push_back(e);
+    }
+
+    for(int i = 0; i < 100; i += 3){
+        world.RemoveComponent<Position>(entities[i]);
+    }
+    world.DestroyEntity(entities[1]);
+
+    for(int i = 0; i < 100; ++i){
+        if(i == 1) continue;
+        ASSERT_EQ(world.GetComponent<Name>(entities[i]).value, "entity with a name long enough to allocate " + std::to_string(i));
+    }
+}
+
+TEST_F(ECSTest, Migration_MovesComponentsWithoutCopying) {
+    RegisterComponent<CopyCounter>();
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 50; ++i){
+        Entity e = world.CreateEntity();
+        CopyCounter c;
+        c.data.assign(16, i);
+        world.AddComponent<CopyCounter>(e, std::move(c));
+        entities.push_back(e);
+    }
+
+    CopyCounter::copies = 0;
+    for(Entity e : entities){
+        world.AddComponent<Position>(e);
+        world.AddComponent<Velocity>(e);
+    }
+    for(int i = 0; i < 50; i += 2){
+        world.RemoveComponent<Position>(entities[i]);
+    }
+    ASSERT_EQ(CopyCounter::copies, 0);
+
+    for(int i = 0; i < 50; ++i){
+        ASSERT_EQ(world.GetComponent<CopyCounter>(entities[i]).data, std::vector<int>(16, i));
+    }
+}
+
+struct Big {
+    float data[64] = {};
+};
+
+TEST_F(ECSTest, ComponentBatch_ReusedAcrossEntitiesAndSpills) {
+    RegisterComponent<Name>();
+    RegisterComponent<Big>();
+
+    ComponentBatch batch;
+    std::vector<Entity> entities;
+    for(int i = 0; i < 3; ++i){
+        Entity e = world.CreateEntity();
+
+        Big big;
+        big.data[63] = (float)i;
+
+        batch.Add(Position{(float)i, 0.f});
+        batch.Add(big);
+        batch.Add(Name{"a name long enough to live on the heap " + std::to_string(i)});
+        batch.Add(Velocity{0.f, (float)i});
+
+        world.AddBatch(e, batch);
+        ASSERT_TRUE(batch.entries.empty());
+        entities.push_back(e);
+    }
+
+    for(int i = 0; i < 3; ++i){
+        Entity e = entities[i];
+        ASSERT_FLOAT_EQ(world.GetComponent<Position>(e).x, (float)i);
+        ASSERT_FLOAT_EQ(world.GetComponent<Big>(e).data[63], (float)i);
+        ASSERT_EQ(world.GetComponent<Name>(e).value, "a name long enough to live on the heap " + std::to_string(i));
+        ASSERT_FLOAT_EQ(world.GetComponent<Velocity>(e).y, (float)i);
+    }
+}
+
+TEST_F(ECSTest, TagComponent_HasNoColumn) {
+    ASSERT_TRUE(ComponentInfos()[GetComponentID<Frozen>()].tag);
+
+    Entity e = world.CreateEntity();
+    world.AddComponent<Position>(e, {1.f, 2.f});
+    world.AddComponent<Frozen>(e);
+
+    Archetype* arch = world.ArchetypeOf(e);
+    ASSERT_TRUE(world.HasComponent<Frozen>(e));
+    ASSERT_EQ(arch->columns.size(), 1u);
+    ASSERT_EQ(arch->componentIDs.size(), 2u);
+    ASSERT_EQ(arch->ColumnIndex(GetComponentID<Frozen>()), Invalid);
+
+    world.RemoveComponent<Frozen>(e);
+    ASSERT_FALSE(world.HasComponent<Frozen>(e));
+    ASSERT_FLOAT_EQ(world.GetComponent<Position>(e).y, 2.f);
+}
+
+TEST_F(ECSTest, TagComponent_FiltersViews) {
+    std::vector<Entity> entities = world.CreateEntities(10, Position{}, Frozen{});
+    Entity thawed = world.CreateEntity();
+    world.AddMultComponent(thawed, Position{}, Velocity{});
+
+    ComponentBatch batch;
+    batch.Add(Position{});
+    batch.Add(Frozen{});
+    Entity batched = world.CreateEntity();
+    world.AddBatch(batched, batch);
+
+    int frozen = 0;
+    world.GetView<Position, Frozen>().Each([&](Entity e, Position&, Frozen&){
+        ASSERT_NE(e, thawed);
+        ++frozen;
+    });
+    ASSERT_EQ(frozen, 11);
+
+    int notFrozen = 0;
+    world.GetViewWithExclude<Position>(Exclude<Frozen>{}).Each([&](Position&){
+        ++notFrozen;
+    });
+    ASSERT_EQ(notFrozen, 1);
+}
+
+TEST_F(ECSTest, SparseComponent_TogglesWithoutMovingEntity) {
+    Entity e = world.CreateEntity();
+    world.AddMultComponent(e, Position{1.f, 2.f}, Velocity{});
+    Archetype* arch = world.ArchetypeOf(e);
+    Position* p = &world.GetComponent<Position>(e);
+
+    for(int i = 0; i < 10; ++i){
+        world.AddComponent<Stunned>(e, {(float)i});
+        ASSERT_TRUE(world.HasComponent<Stunned>(e));
+        ASSERT_FLOAT_EQ(world.GetComponent<Stunned>(e).timeLeft, (float)i);
+        world.RemoveComponent<Stunned>(e);
+        ASSERT_FALSE(world.HasComponent<Stunned>(e));
+    }
+
+    ASSERT_EQ(world.ArchetypeOf(e), arch);
+    ASSERT_EQ(&world.GetComponent<Position>(e), p);
+    ASSERT_EQ(world.archetypes.size(), 1u);
+}
+
+TEST_F(ECSTest, SparseComponent_JoinsViews) {
+    std::vector<Entity> entities = world.CreateEntities(20, Position{}, Health{});
+    for(int i = 0; i < 20; i += 2){
+        world.AddComponent<Stunned>(entities[i], {(float)i});
+    }
+    world.AddComponent<Velocity>(entities[4]);
+
+    Entity loose = world.CreateEntity();
+    world.AddComponent<Stunned>(loose, {100.f});
+
+    int stunned = 0;
+    world.GetView<Position, Stunned>().Each([&](Entity e, Position&, Stunned& s){
+        ASSERT_FLOAT_EQ(s.timeLeft, (float)EntityIndex(e));
+        ++stunned;
+    });
+    ASSERT_EQ(stunned, 10);
+
+    int onlySparse = 0;
+    world.GetView<Stunned>().Each([&](Stunned&){ ++onlySparse; });
+    ASSERT_EQ(onlySparse, 11);
+
+    int moving = 0;
+    world.GetView<Stunned, Velocity>().Each([&](Stunned&, Velocity&){ ++moving; });
+    ASSERT_EQ(moving, 1);
+
+    // Destroying an entity drops its sparse components, a reused index starts clean
+    world.DestroyEntity(entities[0]);
+    world.DestroyEntities(std::vector<Entity>{ entities[2], loose });
+    ASSERT_EQ(world.GetSparseSet<Stunned>().Size(), 8u);
+
+    Entity reused = world.CreateEntity();
+    world.AddComponent<Position>(reused);
+    ASSERT_FALSE(world.HasComponent<Stunned>(reused));
+}
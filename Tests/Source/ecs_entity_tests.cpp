@@ -21,5 +21,135 @@ TEST_F(ECSTest, DestroyEntity_ReusesEntityID) {
     world.DestroyEntity(e1);
 
     Entity e2 = world.CreateEntity();
-    ASSERT_EQ(e1, e2);
+    ASSERT_EQ(EntityIndex(e1), EntityIndex(e2));
+    ASSERT_NE(e1, e2);
+}
+
+TEST_F(ECSTest, DestroyEntity_StaleHandleIsRejected) {
+    Entity e1 = world.CreateEntity();
+    world.AddComponent<Position>(e1, {1.f, 1.f});
+    world.DestroyEntity(e1);
+
+    Entity e2 = world.CreateEntity();
+    world.AddComponent<Position>(e2, {2.f, 2.f});
+
+    ASSERT_FALSE(world.IsAlive(e1));
+    ASSERT_FALSE(world.IsValid(e1));
+    ASSERT_TRUE(world.IsValid(e2));
+
+    // Destroying the stale handle must not touch the entity now using its index
+    world.DestroyEntity(e1);
+    world.DestroyEntities(std::vector<Entity>{ e1 });
+    ASSERT_TRUE(world.IsValid(e2));
+    ASSERT_FLOAT_EQ(world.GetComponent<Position>(e2).x, 2.f);
+
+    // Entities without components are freed too
+    Entity bare = world.CreateEntity();
+    ASSERT_TRUE(world.IsAlive(bare));
+    world.DestroyEntity(bare);
+    ASSERT_FALSE(world.IsAlive(bare));
+    ASSERT_EQ(EntityIndex(world.CreateEntity()), EntityIndex(bare));
+}
+
+TEST_F(ECSTest, EntityHandle_PacksIndexAndGeneration) {
+    Entity e = MakeEntity(5, 3);
+    ASSERT_EQ(EntityIndex(e), 5u);
+    ASSERT_EQ(GetEntityGeneration(e), 3u);
+    ASSERT_EQ(MakeEntity(7, 0), 7u);
+    ASSERT_EQ(GetEntityGeneration(MakeEntity(1, EntityGenerationMask)), EntityGenerationMask);
+}
+
+TEST_F(ECSTest, EntityHandle_RetiresIndexInsteadOfWrapping) {
+    std::vector<Entity> handles;
+    Entity e = world.CreateEntity();
+    world.AddComponent<Health>(e);
+    handles.push_back(e);
+
+    // The LIFO free list hands the same index back until its generations run out
+    for(uint32_t i = 0; i < EntityGenerationMask; ++i){
+        world.DestroyEntity(e);
+        e = world.CreateEntity();
+        world.AddComponent<Health>(e);
+        handles.push_back(e);
+    }
+
+    ASSERT_EQ(EntityIndex(handles[EntityGenerationMask - 1]), EntityIndex(handles[0]));
+    ASSERT_NE(EntityIndex(handles.back()), EntityIndex(handles[0]));
+    for(size_t i = 0; i + 1 < handles.size(); ++i){
+        ASSERT_FALSE(world.IsAlive(handles[i]));
+        ASSERT_NE(handles[i], handles.back());
+    }
+    ASSERT_TRUE(world.IsAlive(handles.back()));
+}
+
+TEST_F(ECSTest, CreateEntities_SpawnsIntoOneArchetype) {
+    Entity existing = world.CreateEntity();
+    world.AddComponent<Position>(existing, {9.f, 9.f});
+    world.AddComponent<Velocity>(existing);
+    world.DestroyEntity(existing);
+
+    std::vector<Entity> spawned = world.CreateEntities(1000, Position{1.f, 2.f}, Velocity{3.f, 4.f});
+    ASSERT_EQ(spawned.size(), 1000u);
+    ASSERT_EQ(EntityIndex(spawned[0]), EntityIndex(existing));
+    ASSERT_FALSE(world.IsAlive(existing));
+
+    Archetype* arch = world.ArchetypeOf(spawned[0]);
+    ASSERT_EQ(arch->Size(), 1000u);
+
+    for(Entity e : spawned){
+        ASSERT_TRUE(world.IsValid(e));
+        ASSERT_EQ(world.ArchetypeOf(e), arch);
+        ASSERT_EQ(arch->EntityAt(world.locations[EntityIndex(e)].index), e);
+        ASSERT_FLOAT_EQ(world.GetComponent<Position>(e).y, 2.f);
+        ASSERT_FLOAT_EQ(world.GetComponent<Velocity>(e).x, 3.f);
+    }
+}
+
+TEST_F(ECSTest, DestroyEntities_CompactsEachArchetype) {
+    std::vector<Entity> all;
+    for(int i = 0; i < 100; ++i){
+        Entity e = world.CreateEntity();
+        world.AddComponent<Health>(e, {i});
+        if(i % 3 == 0) world.AddComponent<Position>(e);
+        all.push_back(e);
+    }
+
+    std::vector<Entity> doomed;
+    for(int i = 0; i < 100; i += 2) doomed.push_back(all[i]);
+    doomed.push_back(all[0]); // duplicates are ignored
+
+    world.DestroyEntities(doomed);
+
+    for(int i = 0; i < 100; ++i){
+        ASSERT_EQ(world.IsValid(all[i]), i % 2 == 1);
+        if(i % 2 == 1){
+            ASSERT_EQ(world.GetComponent<Health>(all[i]).value, i);
+            EntityLocation& loc = world.locations[EntityIndex(all[i])];
+            ASSERT_EQ(world.ArchetypeAt(loc)->EntityAt(loc.index), all[i]);
+        }
+    }
+    ASSERT_EQ(world.freeList.size(), 50u);
+}
+
+TEST_F(ECSTest, DestroyMatching_ClearsMatchingArchetypes) {
+    std::vector<Entity> all;
+    for(int i = 0; i < 30; ++i){
+        Entity e = world.CreateEntity();
+        world.AddComponent<Position>(e);
+        if(i % 2 == 0) world.AddComponent<Velocity>(e);
+        if(i % 3 == 0) world.AddComponent<Disabled>(e);
+        all.push_back(e);
+    }
+
+    world.DestroyMatching(world.GetViewWithExclude<Velocity>(Exclude<Disabled>{}));
+
+    for(int i = 0; i < 30; ++i){
+        bool destroyed = i % 2 == 0 && i % 3 != 0;
+        ASSERT_EQ(world.IsValid(all[i]), !destroyed);
+    }
+
+    world.DestroyMatching(world.GetView<Position>());
+    for(Entity e : all){
+        ASSERT_FALSE(world.IsValid(e));
+    }
 }
@@ -16,3 +16,66 @@ TEST(SignatureTests, Equality) {
     ASSERT_TRUE(a == b);
     ASSERT_FALSE(a == c);
 }
+
+TEST(SignatureTests, SummaryTracksPopulatedChunks) {
+    Signature sig;
+    sig.set(3);
+    sig.set(64 * 5 + 1);
+    ASSERT_EQ(sig.summary, (1ull << 0) | (1ull << 5));
+
+    sig.reset(3);
+    ASSERT_EQ(sig.summary, 1ull << 5);
+    ASSERT_FALSE(sig.test(3));
+
+    sig.reset(64 * 5 + 1);
+    ASSERT_EQ(sig.summary, 0ull);
+    ASSERT_TRUE(sig == Signature{});
+}
+
+TEST(SignatureTests, OperationsAcrossChunks) {
+    Signature a;
+    a.set(1);
+    a.set(200);
+    a.set(MaxComponents - 1);
+
+    Signature b;
+    b.set(200);
+    b.set(MaxComponents - 1);
+
+    Signature c;
+    c.set(2);
+    c.set(201);
+
+    ASSERT_TRUE(a.Contains(b));
+    ASSERT_FALSE(b.Contains(a));
+    ASSERT_TRUE(a.Intersects(b));
+    ASSERT_FALSE(a.Intersects(c));
+    ASSERT_FALSE(a.Contains(c));
+
+    Signature d = b;
+    d.set(1);
+    ASSERT_TRUE(a == d);
+    ASSERT_EQ(a.Hash(), d.Hash());
+}
+
+TEST(SignatureTests, DenseSignaturesUseWholeBitsetKernels) {
+    Signature a;
+    for(ComponentID id = 0; id < MaxComponents; id += 7) a.set(id);
+    ASSERT_GE(PopCount64(a.summary), DenseChunks);
+
+    Signature b = a;
+    ASSERT_TRUE(a == b);
+    ASSERT_TRUE(a.Contains(b));
+    ASSERT_TRUE(a.Intersects(b));
+
+    b.reset(7 * 350);
+    ASSERT_FALSE(a == b);
+    ASSERT_TRUE(a.Contains(b));
+    ASSERT_FALSE(b.Contains(a));
+
+    Signature c;
+    for(ComponentID id = 1; id < MaxComponents; id += 7) c.set(id);
+    ASSERT_FALSE(a.Intersects(c));
+    c.set(7 * 350);
+    ASSERT_TRUE(a.Intersects(c));
+}
@@ -0,0 +1,310 @@
+#include "ecs_test_common.h"
+
+INSTANTIATE_TEST_SUITE_P(
+    Layouts,
+    ECSLayoutTest,
+    ::testing::Values(StorageLayout::Contiguous, StorageLayout::Chunked),
+    [](const ::testing::TestParamInfo<StorageLayout>& info){
+        return info.param == StorageLayout::Chunked ? "Chunked" : "Contiguous";
+    }
+);
+
+TEST_F(ECSTest, ChunkedStorage_SplitsRowsIntoBlocks) {
+    World chunked(StorageLayout::Chunked);
+
+    constexpr uint32_t count = 5000;
+    for(uint32_t i = 0; i < count; ++i){
+        Entity e = chunked.CreateEntity();
+        chunked.AddComponent<Position>(e, {(float)i, 0.f});
+        chunked.AddComponent<Velocity>(e, {1.f, 2.f});
+    }
+
+    Archetype* arch = chunked.ArchetypeOf(0);
+    ASSERT_EQ(arch->Size(), count);
+    ASSERT_GT(arch->BlockCount(), 1u);
+
+    for(Entity e = 0; e < count; ++e){
+        ASSERT_FLOAT_EQ(chunked.GetComponent<Position>(e).x, (float)e);
+    }
+
+    uint32_t visited = 0;
+    chunked.GetView<Position, Velocity>().Each([&](Entity e, Position& p, Velocity& v){
+        ASSERT_FLOAT_EQ(p.x, (float)e);
+        ASSERT_FLOAT_EQ(v.y, 2.f);
+        ++visited;
+    });
+    ASSERT_EQ(visited, count);
+}
+
+TEST_F(ECSTest, ChunkedStorage_GrowthKeepsPointersStable) {
+    World chunked(StorageLayout::Chunked);
+
+    Entity first = chunked.CreateEntity();
+    chunked.AddComponent<Health>(first, {7});
+    Health* h = &chunked.GetComponent<Health>(first);
+
+    for(int i = 0; i < 10000; ++i){
+        Entity e = chunked.CreateEntity();
+        chunked.AddComponent<Health>(e, {i});
+    }
+
+    ASSERT_EQ(h, &chunked.GetComponent<Health>(first));
+    ASSERT_EQ(h->value, 7);
+}
+
+TEST_F(ECSTest, ChunkedStorage_DestroyFillsHoleFromLastBlock) {
+    World chunked(StorageLayout::Chunked);
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 3000; ++i){
+        Entity e = chunked.CreateEntity();
+        chunked.AddComponent<Health>(e, {i});
+        entities.push_back(e);
+    }
+
+    for(int i = 0; i < 3000; i += 2){
+        chunked.DestroyEntity(entities[i]);
+    }
+
+    int sum = 0;
+    chunked.GetView<Health>().Each([&](Health& h){
+        ASSERT_EQ(h.value % 2, 1);
+        sum += 1;
+    });
+    ASSERT_EQ(sum, 1500);
+
+    for(int i = 1; i < 3000; i += 2){
+        ASSERT_EQ(chunked.GetComponent<Health>(entities[i]).value, i);
+    }
+}
+
+TEST_F(ECSTest, ChunkedStorage_CreateEntitiesFillsAcrossBlocks) {
+    World chunked(StorageLayout::Chunked);
+
+    Entity first = chunked.CreateEntity();
+    chunked.AddComponent<Health>(first, {1});
+
+    std::vector<Entity> spawned = chunked.CreateEntities(10000, Health{5});
+    Archetype* arch = chunked.ArchetypeOf(first);
+    ASSERT_EQ(arch->Size(), 10001u);
+    ASSERT_GT(arch->BlockCount(), 1u);
+
+    for(Entity e : spawned){
+        ASSERT_EQ(chunked.GetComponent<Health>(e).value, 5);
+        ASSERT_EQ(arch->EntityAt(chunked.locations[EntityIndex(e)].index), e);
+    }
+    ASSERT_EQ(chunked.GetComponent<Health>(first).value, 1);
+}
+
+struct Vec3SoA {
+    float x, y, z;
+};
+
+namespace ECS{
+template<>
+struct SoALayout<Vec3SoA>{
+    using Field = float;
+    static constexpr size_t Fields = 3;
+};
+}
+
+TEST_P(ECSLayoutTest, SoAStorage_SplitsFields) {
+    RegisterComponent<Vec3SoA>();
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 3000; ++i){
+        Entity e = world.CreateEntity();
+        world.AddComponent<Health>(e, {i});
+        world.AddComponent<Vec3SoA>(e, {(float)i, 2.f * i, 3.f * i});
+        entities.push_back(e);
+    }
+    std::vector<Entity> bulk = world.CreateEntities(1000, Health{-1}, Vec3SoA{1.f, 2.f, 3.f});
+
+    for(int i = 0; i < 3000; i += 2){
+        world.RemoveComponent<Health>(entities[i]);
+    }
+    world.DestroyEntity(entities[1]);
+
+    size_t visited = 0;
+    world.GetView<Vec3SoA>().EachBlock([&](size_t count, SoAColumn<Vec3SoA> v){
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(v[0]) % ColumnAlign, 0u);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(v[1]) % ColumnAlign, 0u);
+        for(size_t i = 0; i < count; ++i){
+            v[0][i] += 1.f;
+        }
+        visited += count;
+    });
+    ASSERT_EQ(visited, 3999u);
+
+    for(int i = 0; i < 3000; ++i){
+        if(i == 1) continue;
+        Vec3SoA v = world.GetComponent<Vec3SoA>(entities[i]);
+        ASSERT_FLOAT_EQ(v.x, i + 1.f);
+        ASSERT_FLOAT_EQ(v.y, 2.f * i);
+        ASSERT_FLOAT_EQ(v.z, 3.f * i);
+    }
+    for(Entity e : bulk){
+        ASSERT_FLOAT_EQ(world.GetComponent<Vec3SoA>(e)[2], 3.f);
+    }
+
+    world.GetComponent<Vec3SoA>(bulk[0]) = Vec3SoA{7.f, 8.f, 9.f};
+    ASSERT_FLOAT_EQ(world.GetComponent<Vec3SoA>(bulk[0])[1], 8.f);
+}
+
+TEST_P(ECSLayoutTest, SoAStorage_EachBlockSkipsDisabledRows) {
+    RegisterComponent<Vec3SoA>();
+
+    std::vector<Entity> entities = world.CreateEntities(3000, Health{1}, Vec3SoA{0.f, 0.f, 0.f});
+    for(size_t i = 0; i < entities.size(); i += 3){
+        world.SetEnabled(entities[i], false);
+    }
+    world.SetComponentEnabled<Health>(entities[1], false);
+
+    size_t visited = 0;
+    world.GetView<Health, Vec3SoA>().EachBlock([&](size_t count, Health* h, SoAColumn<Vec3SoA> v){
+        for(size_t i = 0; i < count; ++i){
+            v[0][i] += (float)h[i].value;
+            v[2][i] = 2.f;
+        }
+        visited += count;
+    });
+    ASSERT_EQ(visited, 1999u);
+
+    for(size_t i = 0; i < entities.size(); ++i){
+        const bool skipped = i % 3 == 0 || i == 1;
+        Vec3SoA v = world.GetComponent<Vec3SoA>(entities[i]);
+        ASSERT_FLOAT_EQ(v.x, skipped ? 0.f : 1.f);
+        ASSERT_FLOAT_EQ(v.z, skipped ? 0.f : 2.f);
+    }
+
+    // Only views reading Health skip the row whose Health is disabled
+    visited = 0;
+    world.GetView<Vec3SoA>().EachBlock([&](size_t count, SoAColumn<Vec3SoA>){ visited += count; });
+    ASSERT_EQ(visited, 2000u);
+
+    // Long runs spanning several mask words
+    for(size_t i = 0; i < entities.size(); i += 3){
+        world.SetEnabled(entities[i], true);
+    }
+    visited = 0;
+    size_t runs = 0;
+    world.GetView<Health>().EachBlock([&](size_t count, Health*){
+        visited += count;
+        ++runs;
+    });
+    ASSERT_EQ(visited, 2999u);
+    ASSERT_LE(runs, 2u + world.ArchetypeOf(entities[0])->BlockCount());
+}
+
+TEST_P(ECSLayoutTest, Storage_ColumnsAreCacheLineAligned) {
+    for(int i = 0; i < 5000; ++i){
+        Entity e = world.CreateEntity();
+        world.AddMultComponent(e, Position{}, Health{}, Velocity{});
+    }
+
+    Archetype* arch = world.ArchetypeOf(0);
+    for(size_t b = 0; b < arch->BlockCount(); ++b){
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(arch->Entities(b)) % ColumnAlign, 0u);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(arch->Column<Position>(b)) % ColumnAlign, 0u);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(arch->Column<Health>(b)) % ColumnAlign, 0u);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(arch->Column<Velocity>(b)) % ColumnAlign, 0u);
+    }
+
+    // Every column is followed by padding up to the next cache line
+    for(size_t c = 0; c + 1 < arch->columns.size(); ++c){
+        size_t end = arch->columns[c].offset + arch->blockRows * arch->columns[c].size;
+        ASSERT_GE(arch->columns[c + 1].offset, AlignUp(end, ColumnAlign));
+    }
+}
+
+struct CountingResource : std::pmr::memory_resource {
+    size_t live = 0;
+    size_t allocations = 0;
+
+    void* do_allocate(size_t bytes, size_t align) override {
+        live += bytes;
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+        live -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST_F(ECSTest, MemoryResource_WorldAllocatesFromResource) {
+    CountingResource counting;
+    {
+        World w(&counting, StorageLayout::Chunked);
+        for(int i = 0; i < 5000; ++i){
+            Entity e = w.CreateEntity();
+            w.AddMultComponent(e, Position{(float)i, 0.f}, Health{i});
+        }
+        w.CreateEntities(1000, Velocity{1.f, 2.f});
+
+        size_t visited = 0;
+        auto view = w.GetView<Position>();
+        view.CachArchetypes();
+        view.EachCached([&](Position&){ ++visited; });
+        ASSERT_EQ(visited, 5000u);
+
+        ASSERT_GT(counting.allocations, 0u);
+        ASSERT_GT(counting.live, 5000u * (sizeof(Position) + sizeof(Health)));
+        ASSERT_FLOAT_EQ(w.GetComponent<Position>(4999).x, 4999.f);
+    }
+    ASSERT_EQ(counting.live, 0u);
+}
+
+TEST_F(ECSTest, MemoryResource_WorldArena) {
+    WorldArena arena;
+    World w(arena.Resource());
+
+    std::vector<Entity> entities = w.CreateEntities(2000, Position{1.f, 2.f}, Health{3});
+    w.DestroyEntities(entities);
+    entities = w.CreateEntities(2000, Position{4.f, 5.f});
+
+    ASSERT_EQ(w.GetComponent<Position>(entities.back()).y, 5.f);
+    ASSERT_EQ(w.archetypes.get_allocator().resource(), arena.Resource());
+    ASSERT_EQ(w.archetypes[0]->resource, arena.Resource());
+}
+
+TEST_P(ECSLayoutTest, MemoryResource_WorldArenaReusesDespawnedStorage) {
+    CountingResource upstream;
+    {
+        WorldArena arena(&upstream);
+        World w(arena.Resource(), GetParam());
+
+        size_t warm = 0;
+        for(int round = 0; round < 10; ++round){
+            std::vector<Entity> entities = w.CreateEntities(20000, Position{}, Health{});
+            w.DestroyEntities(entities);
+            w.Compact();
+
+            // Upstream memory stays flat once the pools have seen one round
+            if(round == 1) warm = upstream.live;
+            if(round > 1) ASSERT_LE(upstream.live, warm);
+        }
+        ASSERT_GT(warm, 0u);
+    }
+    ASSERT_EQ(upstream.live, 0u);
+}
+
+TEST_F(ECSTest, PagedArray_GrowsWithoutMovingElements) {
+    PagedArray<EntityLocation, 4> table;
+    table.resize(3);
+    EntityLocation* first = &table[0];
+    table[2].index = 7;
+
+    table.resize(1000);
+    ASSERT_EQ(&table[0], first);
+    ASSERT_EQ(table[2].index, 7u);
+    ASSERT_EQ(table[999].archetype, 0u);
+    ASSERT_EQ(table.pages.size(), 1000u / 16 + 1);
+
+    table.resize(2);
+    table.resize(3);
+    ASSERT_EQ(table[2].index, 0u);
+}
@@ -25,11 +25,26 @@ struct Disabled {
     int data = 0;
 };
 
+// Tag, no storage
+struct Frozen {};
+
+// Sparse set storage, toggled without moving the entity
+struct Stunned {
+    float timeLeft = 0;
+};
+
+namespace ECS{
+template<>
+struct SparseStorage<Stunned> : std::true_type {};
+}
+
 // Shared fixture
 class ECSTest : public ::testing::Test {
 protected:
     World world;
 
+    explicit ECSTest(StorageLayout layout = StorageLayout::Contiguous):world(layout){}
+
     void SetUp() override {
         // Register components once
         static bool registered = false;
@@ -39,7 +54,14 @@ protected:
             RegisterComponent<Health>();
             RegisterComponent<Renderable>();
             RegisterComponent<Disabled>();
+            RegisterComponent<Frozen>();
             registered = true;
         }
     }
 };
+
+// ECSTest run once per storage layout, see INSTANTIATE_TEST_SUITE_P in ecs_storage_tests.cpp
+class ECSLayoutTest : public ECSTest, public ::testing::WithParamInterface<StorageLayout> {
+protected:
+    ECSLayoutTest():ECSTest(GetParam()){}
+};
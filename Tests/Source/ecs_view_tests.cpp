@@ -1,4 +1,5 @@
 #include "ecs_test_common.h"
+#include <atomic>
 
 TEST_F(ECSTest, View_IteratesCorrectEntities) {
     Entity e1 = world.CreateEntity();
@@ -32,3 +33,282 @@ TEST_F(ECSTest, ViewWithEntity_ReturnsCorrectEntity) {
 
     ASSERT_EQ(found, e);
 }
+
+TEST_P(ECSLayoutTest, View_SkipsDisabledEntities) {
+    std::vector<Entity> entities = world.CreateEntities(3000, Position{}, Velocity{1.f, 0.f});
+    for(size_t i = 0; i < entities.size(); i += 3){
+        world.SetEnabled(entities[i], false);
+    }
+    ASSERT_FALSE(world.IsEnabled(entities[0]));
+    ASSERT_TRUE(world.IsEnabled(entities[1]));
+
+    int visited = 0;
+    world.GetView<Position, Velocity>().Each([&](Entity e, Position& p, Velocity& v){
+        ASSERT_NE(EntityIndex(e) % 3, 0u);
+        p.x += v.x;
+        ++visited;
+    });
+    ASSERT_EQ(visited, 2000);
+
+    // Only views reading Velocity skip entities whose Velocity is disabled
+    world.SetComponentEnabled<Velocity>(entities[1], false);
+    ASSERT_FALSE(world.IsComponentEnabled<Velocity>(entities[1]));
+
+    auto moving = world.GetView<Velocity>();
+    moving.CachArchetypes();
+    int cached = 0;
+    moving.EachCached([&](Velocity&){ ++cached; });
+    ASSERT_EQ(cached, 1999);
+
+    int positions = 0;
+    world.GetView<Position>().Each([&](Position&){ ++positions; });
+    ASSERT_EQ(positions, 2000);
+
+    // Range-for and World::Each skip the same rows, the first row is disabled
+    int iterated = 0;
+    for(auto [p, v] : world.GetView<Position, Velocity>()){
+        (void)p; (void)v;
+        ++iterated;
+    }
+    ASSERT_EQ(iterated, 1999);
+
+    iterated = 0;
+    for(auto [p] : world.GetView<Position>()){
+        (void)p;
+        ++iterated;
+    }
+    ASSERT_EQ(iterated, 2000);
+
+    int worldEach = 0;
+    world.Each<Velocity>([&](Velocity&){ ++worldEach; });
+    ASSERT_EQ(worldEach, 1999);
+
+    worldEach = 0;
+    world.EachWithEntity<Position>([&](Entity e, Position&){
+        ASSERT_NE(EntityIndex(e) % 3, 0u);
+        ++worldEach;
+    });
+    ASSERT_EQ(worldEach, 2000);
+
+    // Swap-removes and archetype moves carry the bits with the entity
+    world.DestroyEntity(entities[2]);
+    world.AddComponent<Health>(entities[0]);
+    world.AddComponent<Health>(entities[1]);
+    ASSERT_FALSE(world.IsEnabled(entities[0]));
+    ASSERT_FALSE(world.IsComponentEnabled<Velocity>(entities[1]));
+    ASSERT_TRUE(world.IsEnabled(entities.back()));
+
+    world.SetEnabled(entities[0], true);
+    world.SetComponentEnabled<Velocity>(entities[1], true);
+    int all = 0;
+    world.GetView<Velocity>().Each([&](Velocity&){ ++all; });
+    ASSERT_EQ(all, 2999 - 999);
+    ASSERT_FLOAT_EQ(world.GetComponent<Position>(entities[1]).x, 1.f);
+}
+
+TEST_F(ECSTest, ComponentEnabled_IgnoresMissingComponents) {
+    Entity bare = world.CreateEntity();
+    Entity sparseOnly = world.CreateEntity();
+    world.AddComponent<Stunned>(sparseOnly, {1.f});
+    Entity other = world.CreateEntity();
+    world.AddComponent<Position>(other);
+
+    for(Entity e : { bare, sparseOnly, other }){
+        world.SetComponentEnabled<Health>(e, false);
+        ASSERT_FALSE(world.IsComponentEnabled<Health>(e));
+        ASSERT_FALSE(world.HasComponent<Health>(e));
+    }
+    ASSERT_TRUE(world.IsComponentEnabled<Position>(other));
+}
+
+TEST_F(ECSTest, CachedView_RefreshesAfterStructuralChanges) {
+    World chunked(StorageLayout::Chunked);
+    std::vector<Entity> entities = chunked.CreateEntities(100, Position{}, Velocity{});
+
+    auto view = chunked.GetView<Position>();
+    view.CachArchetypes();
+
+    auto count = [&]{
+        int n = 0;
+        view.EachCached([&](Position&){ ++n; });
+        return n;
+    };
+    ASSERT_EQ(count(), 100);
+
+    // Growth past a block and a new matching archetype, no manual re-cache
+    chunked.CreateEntities(5000, Position{}, Velocity{});
+    Entity lone = chunked.CreateEntity();
+    chunked.AddComponent<Position>(lone);
+    ASSERT_EQ(count(), 5101);
+    ASSERT_EQ(view.query->matched.size(), 2u);
+
+    chunked.DestroyEntities(entities);
+    chunked.RemoveComponent<Position>(lone);
+    ASSERT_EQ(count(), 5000);
+
+    // An unchanged world keeps the same entries
+    uint64_t version = view.cachedVersion;
+    ASSERT_EQ(count(), 5000);
+    ASSERT_EQ(view.cachedVersion, version);
+
+    // Compact renumbers archetypes, the view matches again from scratch
+    chunked.DestroyEntity(lone);
+    chunked.Compact();
+    ASSERT_EQ(count(), 5000);
+    ASSERT_EQ(view.query->matched.size(), 1u);
+}
+
+TEST_F(ECSTest, QueryRegistry_SharesMatchesBetweenViews) {
+    world.CreateEntities(10, Position{}, Velocity{});
+
+    auto first = world.GetView<Position, Velocity>();
+    auto second = world.GetView<Position, Velocity>();
+    ASSERT_EQ(first.query, second.query);
+    ASSERT_NE(first.query, world.GetView<Position>().query);
+
+    auto withoutHealth = world.GetViewWithExclude<Position>(Exclude<Health>{});
+    ASSERT_NE(withoutHealth.query, world.GetView<Position>().query);
+    ASSERT_EQ(withoutHealth.query, world.GetViewWithExclude<Position>(Exclude<Health>{}).query);
+
+    int n = 0;
+    first.Each([&](Position&, Velocity&){ ++n; });
+    ASSERT_EQ(n, 10);
+    ASSERT_EQ(first.query->matched.size(), 1u);
+
+    // A new archetype is picked up by every view of the query as soon as it is created
+    world.CreateEntities(5, Position{}, Velocity{}, Health{});
+    ASSERT_EQ(first.query->matched.size(), 2u);
+    n = 0;
+    second.Each([&](Position&, Velocity&){ ++n; });
+    ASSERT_EQ(n, 15);
+    ASSERT_EQ(first.query->matched.size(), 2u);
+
+    n = 0;
+    withoutHealth.Each([&](Position&){ ++n; });
+    ASSERT_EQ(n, 10);
+
+    n = 0;
+    for(auto [p, v] : first){
+        (void)p; (void)v;
+        ++n;
+    }
+    ASSERT_EQ(n, 15);
+}
+
+TEST_P(ECSLayoutTest, View_OptionalAndAnyOfTerms) {
+    std::vector<Entity> moving = world.CreateEntities(3000, Position{1.f, 0.f}, Velocity{2.f, 0.f});
+    std::vector<Entity> still = world.CreateEntities(2000, Position{1.f, 0.f});
+    world.CreateEntities(10, Velocity{});
+    std::vector<Entity> hurt = world.CreateEntities(500, Position{}, Health{5});
+
+    size_t withVelocity = 0, total = 0;
+    world.GetView<Position, Optional<Velocity>>().Each([&](Position& p, Velocity* v){
+        if(v){
+            p.x += v->x;
+            ++withVelocity;
+        }
+        ++total;
+    });
+    ASSERT_EQ(total, 5500u);
+    ASSERT_EQ(withVelocity, 3000u);
+    ASSERT_FLOAT_EQ(world.GetComponent<Position>(moving.back()).x, 3.f);
+    ASSERT_FLOAT_EQ(world.GetComponent<Position>(still.back()).x, 1.f);
+
+    size_t either = 0, healthOnly = 0;
+    auto any = world.GetView<AnyOf<Velocity, Health>>();
+    any.Each([&](Entity e, std::tuple<Velocity*, Health*> terms){
+        auto [v, h] = terms;
+        ASSERT_TRUE(v || h);
+        ASSERT_EQ(v != nullptr, world.HasComponent<Velocity>(e));
+        if(h && !v) ++healthOnly;
+        ++either;
+    });
+    ASSERT_EQ(either, 3510u);
+    ASSERT_EQ(healthOnly, 500u);
+
+    size_t cached = 0;
+    any.EachCached([&](std::tuple<Velocity*, Health*>){ ++cached; });
+    ASSERT_EQ(cached, 3510u);
+
+    size_t iterated = 0, withHealth = 0;
+    for(auto [p, h] : world.GetView<Position, Optional<Health>>()){
+        // Only the hurt entities still have Position at the origin
+        ASSERT_EQ(h != nullptr, p.x == 0.f);
+        if(h != nullptr){
+            ASSERT_EQ(h->value, 5);
+            ++withHealth;
+        }
+        ++iterated;
+    }
+    ASSERT_EQ(iterated, 5500u);
+    ASSERT_EQ(withHealth, hurt.size());
+
+    size_t blockRows = 0;
+    world.GetView<Position, Optional<Health>>().EachBlock([&](size_t count, Position*, Health* h){
+        if(h) blockRows += count;
+    });
+    ASSERT_EQ(blockRows, hurt.size());
+}
+
+TEST_F(ECSTest, View_OptionalTermWithSparseComponent) {
+    Entity a = world.CreateEntity();
+    world.AddMultComponent(a, Position{}, Health{3});
+    world.AddComponent<Stunned>(a, {1.f});
+
+    Entity b = world.CreateEntity();
+    world.AddComponent<Stunned>(b, {2.f});
+
+    int found = 0;
+    world.GetView<Stunned, Optional<Health>>().Each([&](Entity e, Stunned&, Health* h){
+        ASSERT_EQ(h != nullptr, e == a);
+        ++found;
+    });
+    ASSERT_EQ(found, 2);
+}
+
+TEST_F(ECSTest, CachedView_ParallelSingleWithSharedQuery) {
+    World chunked(StorageLayout::Chunked);
+    chunked.CreateEntities(2000, Position{}, Velocity{1.f, 0.f});
+
+    auto first = chunked.GetView<Position>();
+    auto second = chunked.GetView<Position>();
+    ASSERT_EQ(first.query, second.query);
+
+    // A structural change after the views were built, both refresh the shared query
+    chunked.CreateEntities(1000, Position{}, Health{});
+
+    std::atomic<int> firstCount{0}, secondCount{0};
+    tf::Executor executor(2);
+    tf::Taskflow tf;
+    first.EachCachedParallelSingle(tf, [&](Position&){ ++firstCount; });
+    second.EachCachedParallelSingle(tf, [&](Position&){ ++secondCount; });
+    executor.run(tf).wait();
+
+    ASSERT_EQ(firstCount.load(), 3000);
+    ASSERT_EQ(secondCount.load(), 3000);
+}
+
+TEST_F(ECSTest, QueryRegistry_EachFromTwoThreadsOnlyReadsQuery) {
+    world.CreateEntities(2000, Position{}, Velocity{});
+
+    auto first = world.GetView<Position>();
+    auto second = world.GetView<Position>();
+    world.GetView<Velocity>();
+
+    // Structural changes on the owning thread, the views are then only iterated
+    world.CreateEntities(1000, Position{}, Health{});
+    world.CreateEntities(10, Velocity{}, Health{});
+    ASSERT_EQ(first.query->matched.size(), 2u);
+
+    std::atomic<int> firstCount{0}, secondCount{0}, worldCount{0};
+    tf::Executor executor(3);
+    tf::Taskflow tf;
+    tf.emplace([&](){ first.Each([&](Position&){ ++firstCount; }); });
+    tf.emplace([&](){ for(auto [p] : second){ (void)p; ++secondCount; } });
+    tf.emplace([&](){ world.Each<Velocity>([&](Velocity&){ ++worldCount; }); });
+    executor.run(tf).wait();
+
+    ASSERT_EQ(firstCount.load(), 3000);
+    ASSERT_EQ(secondCount.load(), 3000);
+    ASSERT_EQ(worldCount.load(), 2010);
+}
@@ -99,3 +99,56 @@ TEST_F(ECSTest, ViewWithExclude_ReturnsZeroWhenAllExcluded) {
 
     ASSERT_EQ(count, 0);
 }
+
+TEST_F(ECSTest, ViewWithExclude_SupportsCachedParallelAndIterators) {
+    World chunked(StorageLayout::Chunked);
+    std::vector<Entity> kept = chunked.CreateEntities(3000, Position{}, Velocity{1.f, 0.f});
+    chunked.CreateEntities(1000, Position{}, Velocity{1.f, 0.f}, Renderable{});
+    chunked.SetEnabled(kept[0], false);
+
+    auto view = chunked.GetView<Position, Velocity>(exclude<Renderable>);
+
+    size_t cached = 0;
+    view.EachCached([&](Entity e, Position&, Velocity&){
+        ASSERT_FALSE(chunked.HasComponent<Renderable>(e));
+        ++cached;
+    });
+    ASSERT_EQ(cached, 2999u);
+
+    tf::Executor executor(2);
+    tf::Taskflow tf;
+    view.EachCachedParallelBatch(tf, [](Position& p, Velocity& v){ p.x += v.x; });
+    executor.run(tf).wait();
+
+    size_t moved = 0;
+    for(auto [p, v] : view){
+        (void)v;
+        if(p.x == 1.f) ++moved;
+    }
+    ASSERT_EQ(moved, 2999u);
+    ASSERT_FLOAT_EQ(chunked.GetComponent<Position>(kept[0]).x, 0.f);
+
+    // New archetypes holding the excluded component stay out of the shared query
+    Entity late = chunked.CreateEntity();
+    chunked.AddMultComponent(late, Position{}, Velocity{}, Renderable{}, Health{});
+    cached = 0;
+    view.EachCached([&](Position&, Velocity&){ ++cached; });
+    ASSERT_EQ(cached, 2999u);
+}
+
+TEST_F(ECSTest, ViewWithExclude_SparseView) {
+    Entity a = world.CreateEntity();
+    world.AddComponent<Stunned>(a, {1.f});
+
+    Entity b = world.CreateEntity();
+    world.AddComponent<Position>(b);
+    world.AddComponent<Stunned>(b, {1.f});
+
+    Entity c = world.CreateEntity();
+    world.AddMultComponent(c, Position{}, Frozen{});
+    world.AddComponent<Stunned>(c, {1.f});
+
+    std::vector<Entity> seen;
+    world.GetView<Stunned>(exclude<Frozen>).Each([&](Entity e, Stunned&){ seen.push_back(e); });
+    ASSERT_EQ(seen, (std::vector<Entity>{ a, b }));
+}